@@ -0,0 +1,59 @@
+#include "AtomicFile.h"
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <system_error>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Write a whole file atomically.  After a crash the file holds either the old or the new contents.
+ * @param filename
+ * @param contents
+ * @return false if anything failed, the old file is then left untouched
+ */
+bool AtomicFile::write(const string& filename, const string& contents) {
+    const string temp = filename + ".tmp";
+    FILE* file = fopen(temp.c_str(), "wb");
+    if (file == nullptr) {
+        cerr << "Unable to open file for writing: " << temp << endl;
+        return false;
+    }
+    bool ok = fwrite(contents.data(), 1, contents.size(), file) == contents.size();
+    ok = fflush(file) == 0 && ok;
+#ifdef _WIN32
+    ok = _commit(_fileno(file)) == 0 && ok;
+#else
+    ok = fsync(fileno(file)) == 0 && ok;
+#endif
+    ok = fclose(file) == 0 && ok;
+    if (!ok) {
+        cerr << "Unable to write file: " << temp << endl;
+        std::remove(temp.c_str());
+        return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temp, filename, error);
+    if (error) {
+        cerr << "Unable to replace " << filename << ": " << error.message() << endl;
+        std::remove(temp.c_str());
+        return false;
+    }
+
+#ifndef _WIN32
+    //make the rename itself survive a crash
+    std::filesystem::path directory = std::filesystem::path(filename).parent_path();
+    int fd = open(directory.empty() ? "." : directory.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+#endif
+    return true;
+}
@@ -0,0 +1,17 @@
+#ifndef DICE_ATOMICFILE_H
+#define DICE_ATOMICFILE_H
+
+#include <string>
+
+using namespace std;
+
+/**
+ * Replaces a file so it is never seen half written.  The new contents go to a temporary file next to it, are
+ * flushed to disk, and are then renamed over the old file.
+ */
+class AtomicFile {
+public:
+    static bool write(const string& filename, const string& contents);
+};
+
+#endif //DICE_ATOMICFILE_H
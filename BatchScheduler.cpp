@@ -0,0 +1,230 @@
+#include "BatchScheduler.h"
+#include "CpuPlacement.h"
+#include "SaveWriter.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+//seconds of work a worker does on a die before the scheduler picks again
+#define SLICE_SECONDS 0.25
+
+//shortest time between saves of the same side count
+#define SAVE_SECONDS 10
+
+/**
+ * Create a scheduler.  Every side count starts from its saved best if there is one.  Dies are made by the worker
+ * that first takes them, so a pinned run allocates their points on that worker's node.
+ * @param sides side counts to optimize
+ * @param threadCount worker threads shared by all side counts
+ * @param timeLimit a side count is dropped after this many seconds without a better result, <= 0 runs until stopped
+ * @param control
+ */
+BatchScheduler::BatchScheduler(const vector<size_t>& sides, size_t threadCount, int timeLimit, RunControl& control)
+        : _threadCount(threadCount), _timeLimit(timeLimit), _control(control), _rng(std::random_device()()) {
+    _unitCap = std::max<size_t>(1, (_threadCount + sides.size() - 1) / std::max<size_t>(1, sides.size()));
+    auto now = std::chrono::steady_clock::now();
+    for (size_t n: sides) {
+        Job job;
+        job.sides = n;
+        job.units.emplace_back();       //die made by the first worker to take it
+        job.savedEnergy = numeric_limits<double>::infinity();
+        job.lastSave = now;
+        job.restarts = std::make_unique<RestartScheduler>(n, std::max<size_t>(1, _unitCap - 1));
+        _jobs.push_back(std::move(job));
+    }
+}
+
+/**
+ * Run until every side count hits the time limit or the run is stopped
+ * @return process exit code
+ */
+int BatchScheduler::run() {
+    vector<std::thread> workers;
+    for (size_t i = 0; i < _threadCount; ++i) workers.emplace_back(&BatchScheduler::workerLoop, this, i);
+
+    while (_control.sleepFor(std::chrono::seconds(10))) {
+        std::lock_guard<QMutex> lock(_mtx);
+        size_t active = 0;
+        for (const auto& job: _jobs) if (!job.finished) ++active;
+        cout << active << "/" << _jobs.size() << " side counts active\n";
+    }
+    for (auto& worker: workers) worker.join();
+
+    //final flush once nothing is changing the dies
+    for (auto& job: _jobs) {
+        if (!job.units[0].die) continue;
+        if (saveDue(job, true)) job.units[0].die->save();
+        cout << "D" << job.sides << " stress=" << setprecision(15) << job.units[0].die->getBestStress() << "\n";
+    }
+    SaveWriter::instance().flush();
+    return 0;
+}
+
+/**
+ * Worker thread body, repeatedly takes a slice of work on the most productive side count
+ * @param workerIndex
+ */
+void BatchScheduler::workerLoop(size_t workerIndex) {
+    CpuPlacement::instance().pinCurrentThread("Worker", workerIndex);
+    while (_control.waitWhilePaused()) {
+        size_t jobIndex, unitIndex;
+        Die* die;
+        Die* polish;
+        if (!acquire(jobIndex, unitIndex, die, polish)) {
+            _control.sleepFor(std::chrono::milliseconds(50));
+            continue;
+        }
+
+        //unit is marked busy so no other thread touches its die
+        if (die == nullptr) die = createDie(jobIndex, unitIndex);
+        if (unitIndex == 0) polish = die;
+        double energyBefore = polish->getBestStress();
+        auto start = std::chrono::steady_clock::now();
+        double seconds = 0;
+        while (seconds < SLICE_SECONDS && !_control.isStopping()) {
+            for (int i = 0; i < 64; ++i) die->optimize();
+            seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+        die->flushNotifications();      //another worker may take the die next, or it may be restarted
+        release(jobIndex, unitIndex, energyBefore, seconds);
+    }
+}
+
+/**
+ * Pick the next piece of work.  Side counts are chosen at random weighted by their improvement rate, side counts
+ * that have not been measured yet go first.  Extra explorer dies are added when there are more threads than
+ * side counts.
+ * @param jobIndex
+ * @param unitIndex
+ * @param die die to work on, nullptr if the caller has to make it
+ * @param polish die holding the side count's best, nullptr if unitIndex is 0 and not made yet
+ * @return false if nothing is free right now
+ */
+bool BatchScheduler::acquire(size_t& jobIndex, size_t& unitIndex, Die*& die, Die*& polish) {
+    std::lock_guard<QMutex> lock(_mtx);
+
+    //find the jobs something could be done on
+    vector<size_t> candidates;
+    double rateSum = 0;
+    size_t rated = 0;
+    bool anyActive = false;
+    for (size_t i = 0; i < _jobs.size(); ++i) {
+        const Job& job = _jobs[i];
+        if (job.finished) continue;
+        anyActive = true;
+        bool free = job.units.size() < _unitCap;
+        for (const auto& unit: job.units) free = free || !unit.busy;
+        if (!job.units[0].die) free = !job.units[0].busy;      //explorers wait until the best is loaded
+        if (!free) continue;
+
+        //measure every side count at least once before trusting the rates
+        if (job.rate < 0) {
+            candidates.assign(1, i);
+            rated = 0;
+            break;
+        }
+        candidates.push_back(i);
+        rateSum += job.rate;
+        ++rated;
+    }
+    if (!anyActive) _control.stop();
+    if (candidates.empty()) return false;
+
+    //weighted pick, every job keeps a small share so a stalled one can still recover
+    jobIndex = candidates[0];
+    if (rated > 1) {
+        double floor = 0.1 * rateSum / rated + 1e-15;
+        vector<double> weights;
+        for (size_t i: candidates) weights.push_back(_jobs[i].rate + floor);
+        jobIndex = candidates[std::discrete_distribution<size_t>(weights.begin(), weights.end())(_rng)];
+    }
+
+    //use an idle die or start an explorer
+    Job& job = _jobs[jobIndex];
+    for (unitIndex = 0; unitIndex < job.units.size(); ++unitIndex) {
+        if (!job.units[unitIndex].busy) break;
+    }
+    if (unitIndex == job.units.size()) job.units.emplace_back();
+    job.units[unitIndex].busy = true;
+    die = job.units[unitIndex].die.get();
+    polish = job.units[0].die.get();
+    return true;
+}
+
+/**
+ * Make the die of a unit the calling worker has just taken, off the lock as loading a best can take a while
+ * @param jobIndex
+ * @param unitIndex
+ * @return the new die, owned by the unit
+ */
+Die* BatchScheduler::createDie(size_t jobIndex, size_t unitIndex) {
+    size_t sides = _jobs[jobIndex].sides;
+    auto die = std::make_unique<Die>(sides, unitIndex == 0);
+    std::lock_guard<QMutex> lock(_mtx);
+    Job& job = _jobs[jobIndex];
+    if (unitIndex == 0) {
+        job.savedEnergy = die->getBestStress();
+    } else {
+        job.restarts->beginRun(unitIndex - 1);
+    }
+    job.units[unitIndex].die = std::move(die);
+    return job.units[unitIndex].die.get();
+}
+
+/**
+ * Return a piece of work and update the side count's improvement rate
+ * @param jobIndex
+ * @param unitIndex
+ * @param energyBefore best energy of the side count when the slice started
+ * @param seconds length of the slice
+ */
+void BatchScheduler::release(size_t jobIndex, size_t unitIndex, double energyBefore, double seconds) {
+    std::unique_lock<QMutex> lock(_mtx);
+    Job& job = _jobs[jobIndex];
+    Die* polish = job.units[0].die.get();
+    Die* die = job.units[unitIndex].die.get();
+    die->addWorkSeconds(seconds);
+    job.units[unitIndex].busy = false;
+
+    //explorers hand better results to the polishing die and restart once they stall
+    if (unitIndex > 0) {
+        if (die->getBestStress() < polish->getBestStress()) polish->offer(*die);
+        if (job.restarts->shouldRestart(unitIndex - 1, *die, seconds)) job.units[unitIndex].die.reset();
+    }
+
+    if (seconds > 0 && std::isfinite(energyBefore)) {
+        double sample = std::max(0.0, (energyBefore - polish->getBestStress()) / energyBefore / seconds);
+        job.rate = (job.rate < 0) ? sample : 0.8 * job.rate + 0.2 * sample;
+    }
+
+    bool save = saveDue(job, false);
+    if (_timeLimit > 0 && !job.units[0].busy && polish->getSecondsSinceLastBest() >= _timeLimit) {
+        job.finished = true;
+        save = saveDue(job, true);
+    }
+
+    //the polishing die is never replaced, so it can be saved without holding up the other threads
+    lock.unlock();
+    if (save) polish->save();
+}
+
+/**
+ * Check if a side count should be written to best/, which it should if it improved.  Unless forced, saves at most
+ * every SAVE_SECONDS.  Must be called with _mtx held, the caller saves the polishing die once it is released.
+ * @param job
+ * @param force
+ * @return true if the polishing die should be saved
+ */
+bool BatchScheduler::saveDue(Job& job, bool force) {
+    auto now = std::chrono::steady_clock::now();
+    if (!force && std::chrono::duration<double>(now - job.lastSave).count() < SAVE_SECONDS) return false;
+    double energy = job.units[0].die->getBestStress();
+    if (energy >= job.savedEnergy && !force) return false;
+    job.savedEnergy = energy;
+    job.lastSave = now;
+    return true;
+}
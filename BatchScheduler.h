@@ -0,0 +1,56 @@
+#ifndef DICE_BATCHSCHEDULER_H
+#define DICE_BATCHSCHEDULER_H
+
+#include <vector>
+#include <memory>
+#include <random>
+#include <chrono>
+#include <QMutex>
+#include "Die.h"
+#include "RestartScheduler.h"
+#include "RunControl.h"
+
+using namespace std;
+
+/**
+ * Optimizes many side counts in one process.  A single pool of worker threads takes short slices of work on
+ * whichever side count has been improving fastest per second of work, and each side count is written to
+ * best/ as it improves.  Dies only get time while a thread holds them, so move rate decay, explorer restarts
+ * and the time limit all count seconds of work, not seconds of waiting for a turn.
+ */
+class BatchScheduler {
+    struct Unit {
+        unique_ptr<Die> die;
+        bool busy = false;
+    };
+
+    struct Job {
+        size_t sides;
+        vector<Unit> units;         //units[0] polishes the best result, the rest explore from random starts
+        double rate = -1;           //smoothed relative energy drop per second of work, negative until measured
+        double savedEnergy;
+        std::chrono::steady_clock::time_point lastSave;
+        bool finished = false;
+        unique_ptr<RestartScheduler> restarts;     //worker i is units[i + 1]
+    };
+
+    QMutex _mtx;
+    vector<Job> _jobs;
+    size_t _threadCount;
+    size_t _unitCap;                //most dies per side count, enough to keep every thread busy
+    int _timeLimit;
+    RunControl& _control;
+    mt19937 _rng;
+
+    bool acquire(size_t& jobIndex, size_t& unitIndex, Die*& die, Die*& polish);
+    Die* createDie(size_t jobIndex, size_t unitIndex);
+    void release(size_t jobIndex, size_t unitIndex, double energyBefore, double seconds);
+    void workerLoop(size_t workerIndex);
+    bool saveDue(Job& job, bool force);
+
+public:
+    BatchScheduler(const vector<size_t>& sides, size_t threadCount, int timeLimit, RunControl& control);
+    int run();
+};
+
+#endif //DICE_BATCHSCHEDULER_H
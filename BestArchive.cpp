@@ -0,0 +1,154 @@
+#include "BestArchive.h"
+#include "AtomicFile.h"
+#include "Checkpoint.h"
+#include "PointSphere.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <set>
+
+/**
+ * Pack every side count found in a directory of best results into an archive.  Each side count is loaded the
+ * normal way so the better of its .bin and .csv goes in.
+ * @param directory
+ * @param filename
+ * @return number of side counts packed
+ */
+size_t BestArchive::build(const string& directory, const string& filename) {
+    set<size_t> sideCounts;
+    for (const auto& file: std::filesystem::directory_iterator(directory)) {
+        string extension = file.path().extension().string();
+        if (extension != ".csv" && extension != CHECKPOINT_EXTENSION) continue;
+        try {
+            sideCounts.insert(stoul(file.path().stem().string()));
+        } catch (...) {
+        }
+    }
+
+    vector<Entry> index;
+    vector<double> coordinates;
+    for (size_t sides: sideCounts) {
+        if (sides < 2 || sides % 2 == 1) continue;
+        try {
+            PointSphere sphere(sides);
+            Entry entry{};
+            entry.sideCount = sides;
+            entry.rate = sphere.load();
+            entry.stress = sphere.getTotalStress();
+            entry.offset = coordinates.size() * sizeof(double);
+            for (size_t i = 0; i < sides; i += 2) {
+                Vec3 point = sphere.getPoint(i);
+                coordinates.push_back(point.x);
+                coordinates.push_back(point.y);
+                coordinates.push_back(point.z);
+            }
+            entry.checksum = Checkpoint::fnv1a(coordinates.data() + entry.offset / sizeof(double),
+                                               sides / 2 * 3 * sizeof(double));
+            index.push_back(entry);
+        } catch (...) {
+            cerr << "Skipping unreadable best for " << sides << " sides" << endl;
+        }
+    }
+
+    //offsets so far are into the coordinate block, which starts after the index
+    size_t dataStart = sizeof(Header) + index.size() * sizeof(Entry);
+    for (auto& entry: index) entry.offset += dataStart;
+
+    Header header{};
+    memcpy(header.magic, ARCHIVE_MAGIC, sizeof(header.magic));
+    header.version = ARCHIVE_VERSION;
+    header.entryCount = index.size();
+    header.checksum = Checkpoint::fnv1a(index.data(), index.size() * sizeof(Entry));
+
+    string bytes(reinterpret_cast<const char*>(&header), sizeof(header));
+    bytes.append(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(Entry));
+    bytes.append(reinterpret_cast<const char*>(coordinates.data()), coordinates.size() * sizeof(double));
+    return AtomicFile::write(filename, bytes) ? index.size() : 0;
+}
+
+/**
+ * Open an archive and check its index
+ * @param filename
+ */
+BestArchive::BestArchive(const string& filename) : _file(filename) {
+    if (!_file.isOpen() || _file.size() < sizeof(Header)) return;
+    const Header& head = header();
+    if (memcmp(head.magic, ARCHIVE_MAGIC, sizeof(head.magic)) != 0) return;
+    if (head.version != ARCHIVE_VERSION) return;
+    if (_file.size() < sizeof(Header) + head.entryCount * sizeof(Entry)) return;
+    if (Checkpoint::fnv1a(entries(), head.entryCount * sizeof(Entry)) != head.checksum) return;
+    for (size_t i = 0; i < head.entryCount; ++i) {
+        const Entry& e = entries()[i];
+        if (e.offset + e.sideCount / 2 * 3 * sizeof(double) > _file.size()) return;
+    }
+    _valid = true;
+}
+
+/**
+ * File exists, is an archive of this version and its index is intact
+ * @return
+ */
+bool BestArchive::isValid() const {
+    return _valid;
+}
+
+/**
+ * Number of side counts in the archive
+ * @return
+ */
+size_t BestArchive::size() const {
+    return _valid ? header().entryCount : 0;
+}
+
+const BestArchive::Entry& BestArchive::entry(size_t index) const {
+    return entries()[index];
+}
+
+/**
+ * Look up a side count
+ * @param sideCount
+ * @return nullptr if it is not in the archive
+ */
+const BestArchive::Entry* BestArchive::find(size_t sideCount) const {
+    if (!_valid) return nullptr;
+    const Entry* first = entries();
+    const Entry* last = first + header().entryCount;
+    const Entry* found = std::lower_bound(first, last, sideCount, [](const Entry& e, size_t sides) {
+        return e.sideCount < sides;
+    });
+    if (found == last || found->sideCount != sideCount) return nullptr;
+    return found;
+}
+
+/**
+ * Check a side count's points against their checksum
+ * @param entry
+ * @return
+ */
+bool BestArchive::verify(const Entry& entry) const {
+    return Checkpoint::fnv1a(coordinates(entry), entry.sideCount / 2 * 3 * sizeof(double)) == entry.checksum;
+}
+
+/**
+ * Stored point straight from the archive
+ * @param entry
+ * @param index
+ * @return
+ */
+Vec3 BestArchive::point(const Entry& entry, size_t index) const {
+    const double* xyz = coordinates(entry) + index * 3;
+    return {xyz[0], xyz[1], xyz[2]};
+}
+
+const BestArchive::Header& BestArchive::header() const {
+    return *reinterpret_cast<const Header*>(_file.data());
+}
+
+const BestArchive::Entry* BestArchive::entries() const {
+    return reinterpret_cast<const Entry*>(_file.data() + sizeof(Header));
+}
+
+const double* BestArchive::coordinates(const Entry& entry) const {
+    return reinterpret_cast<const double*>(_file.data() + entry.offset);
+}
@@ -0,0 +1,65 @@
+#ifndef DICE_BESTARCHIVE_H
+#define DICE_BESTARCHIVE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+#include "Vec3.h"
+
+using namespace std;
+
+//archive of every best result, built from best/ by -pack
+#define ARCHIVE_FILE "best.pack"
+
+//first bytes of an archive
+#define ARCHIVE_MAGIC "DPAK"
+
+//bumped whenever the layout changes, older versions are rejected
+#define ARCHIVE_VERSION 1
+
+/**
+ * The whole best/ table in one memory mapped file.  A header and an index sorted by side count are followed
+ * by the stored points of each side count as raw doubles, so a side count is found by binary search and its
+ * points read in place.  Files are little endian.
+ */
+class BestArchive {
+public:
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint64_t entryCount;
+        uint64_t checksum;      //FNV-1a of the index
+    };
+
+    struct Entry {
+        uint64_t sideCount;
+        uint64_t offset;        //from the start of the file to the first coordinate
+        double stress;
+        double rate;
+        uint64_t checksum;      //FNV-1a of the coordinates
+    };
+
+    static size_t build(const string& directory, const string& filename = ARCHIVE_FILE);
+
+    explicit BestArchive(const string& filename = ARCHIVE_FILE);
+    BestArchive(const BestArchive&) = delete;
+    BestArchive& operator=(const BestArchive&) = delete;
+
+    bool isValid() const;
+    size_t size() const;
+    const Entry& entry(size_t index) const;
+    const Entry* find(size_t sideCount) const;
+    bool verify(const Entry& entry) const;
+    Vec3 point(const Entry& entry, size_t index) const;
+
+private:
+    MappedFile _file;
+    bool _valid = false;
+
+    const Header& header() const;
+    const Entry* entries() const;
+    const double* coordinates(const Entry& entry) const;
+};
+
+#endif //DICE_BESTARCHIVE_H
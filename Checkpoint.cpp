@@ -0,0 +1,134 @@
+#include "Checkpoint.h"
+#include "AtomicFile.h"
+#include <cstring>
+
+/**
+ * FNV-1a hash of some bytes
+ * @param data
+ * @param size
+ * @param hash hash of the bytes before these, to hash several blocks as one
+ * @return
+ */
+uint64_t Checkpoint::fnv1a(const void* data, size_t size, uint64_t hash) {
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+/**
+ * Checksum of a header and its points
+ * @param header checksum field is ignored
+ * @param coordinates x, y, z of each stored point
+ * @param count number of doubles
+ * @return
+ */
+uint64_t Checkpoint::checksum(const Header& header, const double* coordinates, size_t count) {
+    Header copy = header;
+    copy.checksum = 0;
+    uint64_t hash = fnv1a(&copy, sizeof(copy));
+    return fnv1a(coordinates, count * sizeof(double), hash);
+}
+
+/**
+ * Bytes of a checkpoint file
+ * @param sideCount
+ * @param stress
+ * @param rate
+ * @param points stored points, one per mirror pair
+ * @return
+ */
+string Checkpoint::encode(size_t sideCount, double stress, double rate, const vector<Vec3>& points) {
+    vector<double> coordinates;
+    coordinates.reserve(points.size() * 3);
+    for (const auto& point: points) {
+        coordinates.push_back(point.x);
+        coordinates.push_back(point.y);
+        coordinates.push_back(point.z);
+    }
+
+    Header header{};
+    memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.version = CHECKPOINT_VERSION;
+    header.sideCount = sideCount;
+    header.stress = stress;
+    header.rate = rate;
+    header.checksum = checksum(header, coordinates.data(), coordinates.size());
+
+    string bytes(reinterpret_cast<const char*>(&header), sizeof(header));
+    bytes.append(reinterpret_cast<const char*>(coordinates.data()), coordinates.size() * sizeof(double));
+    return bytes;
+}
+
+/**
+ * Write a checkpoint file, replacing any old one atomically
+ * @param filename
+ * @param sideCount
+ * @param stress
+ * @param rate
+ * @param points stored points, one per mirror pair
+ * @return false if the file could not be written
+ */
+bool Checkpoint::write(const string& filename, size_t sideCount, double stress, double rate,
+                       const vector<Vec3>& points) {
+    return AtomicFile::write(filename, encode(sideCount, stress, rate, points));
+}
+
+/**
+ * Check the bytes of a checkpoint, from a file or anywhere else
+ * @param data
+ * @param size
+ * @return true if they are a checkpoint of this version and the checksum matches
+ */
+bool Checkpoint::validate(const unsigned char* data, size_t size) {
+    if (data == nullptr || size < sizeof(Header)) return false;
+
+    Header head;
+    memcpy(&head, data, sizeof(head));
+    if (memcmp(head.magic, CHECKPOINT_MAGIC, sizeof(head.magic)) != 0) return false;
+    if (head.version != CHECKPOINT_VERSION) return false;
+    size_t count = head.sideCount / 2 * 3;
+    if (size != sizeof(Header) + count * sizeof(double)) return false;
+
+    //same hash as checksum, taken straight from the bytes so a mapped file is not copied
+    uint64_t expected = head.checksum;
+    head.checksum = 0;
+    return fnv1a(data + sizeof(Header), count * sizeof(double), fnv1a(&head, sizeof(head))) == expected;
+}
+
+/**
+ * Open a checkpoint file and check it
+ * @param filename
+ */
+Checkpoint::Checkpoint(const string& filename) : _file(filename) {
+    if (!_file.isOpen()) return;
+    _valid = validate(_file.data(), _file.size());
+}
+
+/**
+ * File exists, is a checkpoint of this version and its checksum matches
+ * @return
+ */
+bool Checkpoint::isValid() const {
+    return _valid;
+}
+
+const Checkpoint::Header& Checkpoint::header() const {
+    return *reinterpret_cast<const Header*>(_file.data());
+}
+
+/**
+ * Stored point straight from the file
+ * @param index
+ * @return
+ */
+Vec3 Checkpoint::point(size_t index) const {
+    const double* xyz = coordinates() + index * 3;
+    return {xyz[0], xyz[1], xyz[2]};
+}
+
+const double* Checkpoint::coordinates() const {
+    return reinterpret_cast<const double*>(_file.data() + sizeof(Header));
+}
@@ -0,0 +1,55 @@
+#ifndef DICE_CHECKPOINT_H
+#define DICE_CHECKPOINT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+#include "Vec3.h"
+
+using namespace std;
+
+//first bytes of every checkpoint file
+#define CHECKPOINT_MAGIC "DICE"
+
+//bumped whenever the layout changes, older versions are rejected
+#define CHECKPOINT_VERSION 1
+
+/**
+ * Binary best configuration file.  A fixed header is followed by the stored points as raw doubles, so values
+ * come back bit for bit and the file can be used straight from a memory mapping.  Files are little endian.
+ */
+class Checkpoint {
+public:
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint64_t sideCount;
+        double stress;
+        double rate;
+        uint64_t checksum;      //FNV-1a of the header with this field zeroed, then the points
+    };
+
+    static string encode(size_t sideCount, double stress, double rate, const vector<Vec3>& points);
+    static bool write(const string& filename, size_t sideCount, double stress, double rate,
+                      const vector<Vec3>& points);
+    static uint64_t checksum(const Header& header, const double* coordinates, size_t count);
+    static uint64_t fnv1a(const void* data, size_t size, uint64_t hash = 14695981039346656037ull);
+    static bool validate(const unsigned char* data, size_t size);
+
+    explicit Checkpoint(const string& filename);
+    Checkpoint(const Checkpoint&) = delete;
+    Checkpoint& operator=(const Checkpoint&) = delete;
+
+    bool isValid() const;
+    const Header& header() const;
+    Vec3 point(size_t index) const;
+
+private:
+    MappedFile _file;
+    bool _valid = false;
+
+    const double* coordinates() const;
+};
+
+#endif //DICE_CHECKPOINT_H
@@ -0,0 +1,139 @@
+#include "CpuPlacement.h"
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+//where Linux lists the cpus of each NUMA node
+#define NODE_CPULIST "/sys/devices/system/node/node%d/cpulist"
+
+//highest node number probed
+#define MAX_NUMA_NODES 64
+
+namespace {
+    /**
+     * Parse a kernel cpu list like "0-3,8-11"
+     * @param text
+     * @return
+     */
+    vector<int> parseCpuList(const string& text) {
+        vector<int> result;
+        stringstream ss(text);
+        string item;
+        while (getline(ss, item, ',')) {
+            if (item.empty()) continue;
+            size_t dash = item.find('-');
+            int first = stoi(item.substr(0, dash));
+            int last = (dash == string::npos) ? first : stoi(item.substr(dash + 1));
+            for (int cpu = first; cpu <= last; ++cpu) result.push_back(cpu);
+        }
+        return result;
+    }
+}
+
+/**
+ * Placement shared by the whole program
+ * @return
+ */
+CpuPlacement& CpuPlacement::instance() {
+    static CpuPlacement placement;
+    return placement;
+}
+
+/**
+ * Turn pinning on or off for threads started from now on
+ * @param enabled
+ */
+void CpuPlacement::setEnabled(bool enabled) {
+    std::lock_guard<QMutex> lock(_mtx);
+    _enabled = enabled;
+}
+
+/**
+ * Read the NUMA nodes and the cpus this process may run on.  Falls back to one node holding every allowed
+ * cpu when the kernel does not list nodes.
+ */
+void CpuPlacement::loadTopology() {
+#ifdef __linux__
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return;
+
+    for (int node = 0; node < MAX_NUMA_NODES; ++node) {
+        char path[128];
+        snprintf(path, sizeof(path), NODE_CPULIST, node);
+        ifstream inFile(path);
+        if (!inFile.is_open()) continue;
+        string line;
+        getline(inFile, line);
+
+        //skip cpus outside our affinity mask, e.g. when run under taskset or a container limit
+        vector<int> cpus;
+        for (int cpu: parseCpuList(line)) {
+            if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)) cpus.push_back(cpu);
+        }
+        if (cpus.empty()) continue;
+        _nodeCpus.push_back(cpus);
+        _nodeIds.push_back(node);
+    }
+
+    if (_nodeCpus.empty()) {
+        vector<int> cpus;
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) if (CPU_ISSET(cpu, &allowed)) cpus.push_back(cpu);
+        if (cpus.empty()) return;
+        _nodeCpus.push_back(cpus);
+        _nodeIds.push_back(0);
+    }
+#endif
+}
+
+/**
+ * Pin the calling thread if pinning is on.  Workers are dealt out one per node in turn, so worker i goes to
+ * node i % nodes, and wrap around onto the same cores when there are more workers than cores.  Prints the
+ * topology on the first call and one line per pinned thread.
+ * @param name shown in the placement report
+ * @param workerIndex
+ */
+void CpuPlacement::pinCurrentThread(const string& name, size_t workerIndex) {
+    std::lock_guard<QMutex> lock(_mtx);
+    if (!_enabled) return;
+
+#ifdef __linux__
+    if (!_reported) {
+        _reported = true;
+        loadTopology();
+        cout << "Pinning threads over " << _nodeCpus.size() << " NUMA node(s):";
+        for (size_t node = 0; node < _nodeCpus.size(); ++node) {
+            cout << " node" << _nodeIds[node] << "=" << _nodeCpus[node].size() << " cpus";
+        }
+        cout << "\n";
+    }
+    if (_nodeCpus.empty()) return;
+
+    size_t node = workerIndex % _nodeCpus.size();
+    const vector<int>& cpus = _nodeCpus[node];
+    int cpu = cpus[(workerIndex / _nodeCpus.size()) % cpus.size()];
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (error != 0) {
+        cerr << name << " " << workerIndex << ": unable to pin to cpu " << cpu << " (error " << error << ")\n";
+        return;
+    }
+    cout << name << " " << workerIndex << " pinned to cpu " << cpu << " node " << _nodeIds[node] << "\n";
+#else
+    if (!_reported) {
+        _reported = true;
+        cerr << "Thread pinning is only supported on Linux, threads are left unpinned\n";
+    }
+    (void) name;
+    (void) workerIndex;
+#endif
+}
@@ -0,0 +1,32 @@
+#ifndef DICE_CPUPLACEMENT_H
+#define DICE_CPUPLACEMENT_H
+
+#include <string>
+#include <vector>
+#include <QMutex>
+
+using namespace std;
+
+/**
+ * Optional pinning of optimizer threads to cores, spread round robin over the NUMA nodes so each node gets an
+ * even share.  A worker that creates its dies after pinning gets their points allocated on its own node by
+ * first touch.  Only does anything on Linux, elsewhere threads float as before.
+ */
+class CpuPlacement {
+    QMutex _mtx;
+    bool _enabled = false;
+    bool _reported = false;
+    vector<vector<int>> _nodeCpus;     //allowed cpus of each NUMA node that has any
+    vector<int> _nodeIds;              //kernel number of each of those nodes
+
+    CpuPlacement() = default;
+    void loadTopology();
+
+public:
+    static CpuPlacement& instance();
+
+    void setEnabled(bool enabled);
+    void pinCurrentThread(const string& name, size_t workerIndex);
+};
+
+#endif //DICE_CPUPLACEMENT_H
@@ -3,43 +3,146 @@
 //
 
 #include "Die.h"
+#include "Checkpoint.h"
+#include "LabelFile.h"
+#include "Labeler.h"
 #include <algorithm>
 #include <cmath>
 #include <set>
+#include <sstream>
 
-bool Die::_optimizationPaused = false;
+//shortest time between two notifications of a new best
+#define NOTIFY_INTERVAL_MS 100
+
+//labelling searches started from different points, run in parallel
+#define LABEL_TRIALS 32
+
+//exponents a random start is relaxed under, softest first, each pushing as 1/r^s like the search's own 1/r^2.
+//The last must be the scoring exponent.  No log stage, it would push as 1/r the same as s=1
+static const double continuationExponents[] = {0.5, 1, 1.5, 2};
+static const size_t continuationStageCount = sizeof(continuationExponents) / sizeof(continuationExponents[0]);
 
 /**
- * Create die object
+ * Create die object using the tuned preset for its side count
  * @param sides
  * @param loadBest
  */
-Die::Die(size_t sides, bool loadBest) : _best(sides), _current(sides),
-                                        _lastBestTime(std::chrono::steady_clock::now()) {
+Die::Die(size_t sides, bool loadBest) : Die(sides, loadBest, OptimizerParams::forSides(sides)) {
+}
+
+/**
+ * Create die object with explicit search parameters
+ * @param sides
+ * @param loadBest
+ * @param params
+ */
+Die::Die(size_t sides, bool loadBest, const OptimizerParams& params)
+        : Die(sides, loadBest, params, std::random_device{}()) {
+}
+
+/**
+ * Create die object whose moves are seeded, so with srand also seeded the whole run repeats exactly
+ * @param sides
+ * @param loadBest
+ * @param params
+ * @param seed seed of the move generator
+ */
+Die::Die(size_t sides, bool loadBest, const OptimizerParams& params, unsigned int seed)
+        : _best(sides), _current(sides), _lastBestTime(std::chrono::steady_clock::now()), _params(params),
+          _nextReduceTime(params.reduceRate), _rng(seed) {
     //set default start rates
-    _moveRate = 0.1 / sides;
+    _moveRate = _params.startRate / sides;
     _moveRateMin = 1 / sides / sides;
+    _pointChanged.assign(sides / 2, false);
 
     //try to load best if requested
-    if (!loadBest) return;
-    try {
-        _moveRate = _best.load();
-        _current = _best;
-        _moveRateMin = 1 / sides / sides;
-    } catch (...) {
+    bool loaded = false;
+    if (loadBest) {
+        try {
+            _moveRate = _best.load();
+            _moveRateMin = 1 / sides / sides;
+            loaded = true;
+        } catch (...) {
+        }
+    }
+
+    //start current from best so only changed points need copying back
+    _current = _best;
+    _bestStress.store(_best.getTotalStress());
+
+    //random starts are first relaxed under softer potentials so they settle into a better basin
+    _continuationStage = continuationStageCount - 1;
+    if (!loaded && _params.continuationSteps > 0) {
+        _continuationStage = 0;
+        _current.setExponent(continuationExponents[0]);
     }
 }
 
+/**
+ * Rebuild a die exactly as it was when writeState stored it, so it carries on with the same moves
+ * @param sides
+ * @param state
+ */
+Die::Die(size_t sides, RunState::Reader& state) : Die(sides, false) {
+    _moveRate = state.get<double>();
+    _moveRateMin = state.get<double>();
+    _best.readState(state);
+    _current.readState(state);
+    _bestStress.store(_best.getTotalStress());
+    auto sinceBest = std::chrono::duration<double>(state.get<double>());
+    _lastBestTime = std::chrono::steady_clock::now() -
+                    std::chrono::duration_cast<std::chrono::steady_clock::duration>(sinceBest);
+    _nextReduceTime = state.get<int64_t>();
+    _lastOptimizedIndex = state.get<uint64_t>();
+    _changedPoints = state.getIndices();
+    _pointChanged.assign(sides / 2, false);
+    for (size_t index: _changedPoints) {
+        if (index >= _pointChanged.size()) throw runtime_error("run state is corrupt");
+        _pointChanged[index] = true;
+    }
+    _continuationStage = state.get<uint64_t>();
+    _continuationMoves = state.get<uint64_t>();
+    _movesSinceReorder = state.get<uint64_t>();
+    if (_continuationStage >= continuationStageCount || _lastOptimizedIndex >= sides) {
+        throw runtime_error("run state is corrupt");
+    }
+    istringstream rng(state.getString());
+    rng >> _rng;
+    if (!rng) throw runtime_error("run state is corrupt");
+}
+
+/**
+ * Store everything the search depends on.  Only call from the thread optimizing the die.
+ * @param state
+ */
+void Die::writeState(RunState::Writer& state) const {
+    state.put(_moveRate);
+    state.put(_moveRateMin);
+    _best.writeState(state);
+    _current.writeState(state);
+    state.put(std::chrono::duration<double>(std::chrono::steady_clock::now() - _lastBestTime).count());
+    state.put<int64_t>(_nextReduceTime);
+    state.put<uint64_t>(_lastOptimizedIndex);
+    state.putIndices(_changedPoints);
+    state.put<uint64_t>(_continuationStage);
+    state.put<uint64_t>(_continuationMoves);
+    state.put<uint64_t>(_movesSinceReorder);
+    ostringstream rng;
+    rng << _rng;
+    state.putString(rng.str());
+}
+
 /**
  * Try to optimize a point
  */
 void Die::optimize() {
-    if (isOptimizationPaused()) return; //don't optimize if paused
+    if (_hasOffer.load()) adoptOffer();
+    if (_notifyPending) notifyListeners();
 
     size_t optimizeIndex;
-    if (rand() % 16 == 0) {
+    if (_rng() % _params.randomPickOdds == 0) {
         //occasionally just pick one at random
-        optimizeIndex = rand() % _current.sideCount();
+        optimizeIndex = _rng() % _current.sideCount();
     } else {
         // Store distances and indices
         std::vector<std::pair<double, size_t>> distances;
@@ -62,8 +165,10 @@ void Die::optimize() {
                       return a.first < b.first;  // Compare based on distances
                   });
 
-        // Randomly pick one of the three closest points
-        size_t randomIndex = rand() % static_cast<size_t>(sqrt(_current.sideCount()));
+        // Randomly pick one of the closest points
+        size_t window = static_cast<size_t>(_params.neighbourWindow * sqrt(_current.sideCount()));
+        window = std::max<size_t>(1, std::min(window, distances.size()));
+        size_t randomIndex = _rng() % window;
 
         // Set _lastOptimizedIndex to the index of the randomly selected closest point
         _lastOptimizedIndex = distances[randomIndex].second;
@@ -78,23 +183,240 @@ void Die::optimize() {
 
     //move the point
     _current.movePoint(optimizeIndex, newPoint);
+    markChanged(optimizeIndex);
+
+    //keep neighbours close together in memory as points drift
+    if (_params.reorderSweeps > 0 && ++_movesSinceReorder >= _params.reorderSweeps * _current.sideCount()) {
+        _movesSinceReorder = 0;
+        reorderPoints();
+    }
+
+    //still annealing so energy is not comparable to best yet
+    if (_continuationStage + 1 < continuationStageCount) {
+        advanceContinuation();
+        return;
+    }
 
     //see if best
     if (_current.getTotalStress(false) < _best.getTotalStress()) {
-        _nextReduceTime = REDUCE_RATE;
-        _best = _current;
-        _lastBestTime = std::chrono::steady_clock::now();
-        _labels.clear();    //remove cached labels since things have moved
+        ++_accepted;
+        _nextReduceTime = _params.reduceRate;
+        _best.copyPoints(_current, _changedPoints);
+        for (size_t index: _changedPoints) _pointChanged[index] = false;
+        _changedPoints.clear();
+        markBestTime();
+        bestChanged();
         return;
     }
 
+    ++_rejected;
+
     //reduce rate if it has been a while
     if (getSecondsSinceLastBest() > _nextReduceTime) {
-        _nextReduceTime += REDUCE_RATE;
+        _nextReduceTime += _params.reduceRate;
         reduceRate();
     }
 }
 
+/**
+ * Record that a point in _current no longer matches _best
+ * @param sideIndex
+ */
+void Die::markChanged(size_t sideIndex) {
+    size_t index = sideIndex / 2;
+    if (_pointChanged[index]) return;
+    _pointChanged[index] = true;
+    _changedPoints.push_back(index);
+}
+
+/**
+ * Sort best and current along a space filling curve in the same way and move every stored index over
+ */
+void Die::reorderPoints() {
+    vector<bool> flip;
+    vector<size_t> order = _current.curveOrder(flip);
+    _current.permute(order, flip);
+    _best.permute(order, flip);
+
+    vector<size_t> newIndex(order.size());
+    for (size_t i = 0; i < order.size(); ++i) newIndex[order[i]] = i;
+    for (size_t& index: _changedPoints) index = newIndex[index];
+    _pointChanged.assign(_pointChanged.size(), false);
+    for (size_t index: _changedPoints) _pointChanged[index] = true;
+
+    size_t last = _lastOptimizedIndex / 2;
+    _lastOptimizedIndex = newIndex[last] * 2 + ((_lastOptimizedIndex % 2 == 1) != flip[last]);
+}
+
+/**
+ * Count an annealing move and step the potential towards the scoring exponent once the stage is done.
+ * Leaving the last soft stage makes the relaxed configuration the new best.
+ */
+void Die::advanceContinuation() {
+    if (++_continuationMoves < _params.continuationSteps * _current.sideCount()) return;
+    _continuationMoves = 0;
+    _current.setExponent(continuationExponents[++_continuationStage]);
+    if (_continuationStage + 1 < continuationStageCount) return;
+
+    //back on the real potential, start the normal search from here
+    _best = _current;
+    for (size_t index: _changedPoints) _pointChanged[index] = false;
+    _changedPoints.clear();
+    markBestTime();
+    bestChanged();
+}
+
+/**
+ * Hand this die another die's best.  It is adopted by the thread optimizing this die on its next step if it is
+ * still better, so the optimizing thread is the only one that ever changes _best and _current.
+ * @param other
+ */
+void Die::offer(const Die& other) {
+    offer(other.getBest(), other._moveRate);
+}
+
+/**
+ * Hand this die a configuration found elsewhere, along with the move rate that found it
+ * @param candidate
+ * @param rate
+ */
+void Die::offer(const PointSphere& candidate, double rate) {
+    auto copy = std::make_unique<PointSphere>(candidate);
+    std::lock_guard<QMutex> lock(_offerMutex);
+    if (_offered && _offered->getTotalStress() <= copy->getTotalStress()) return;
+    _offered = std::move(copy);
+    _offeredRate = rate;
+    _hasOffer.store(true);
+}
+
+/**
+ * Current move rate
+ * @return
+ */
+double Die::getMoveRate() const {
+    return _moveRate;
+}
+
+/**
+ * Replace best and current with the offered sphere if it beats best
+ */
+void Die::adoptOffer() {
+    std::unique_ptr<PointSphere> candidate;
+    double rate;
+    {
+        std::lock_guard<QMutex> lock(_offerMutex);
+        candidate = std::move(_offered);
+        rate = _offeredRate;
+        _hasOffer.store(false);
+    }
+    if (!candidate || candidate->getTotalStress() >= _best.getTotalStress()) return;
+
+    _best = *candidate;
+    _current = _best;
+    _continuationStage = continuationStageCount - 1;    //an offered configuration is already relaxed
+    _continuationMoves = 0;
+    for (size_t index: _changedPoints) _pointChanged[index] = false;
+    _changedPoints.clear();
+    _moveRate = rate;
+    _nextReduceTime = _params.reduceRate;
+    markBestTime();
+    bestChanged();
+}
+
+/**
+ * Count a change of _best and tell listeners, unless they were told too recently in which case a later step
+ * tells them
+ */
+void Die::bestChanged() {
+    _bestStress.store(_best.getTotalStress());
+    _version.fetch_add(1);
+    _notifyPending = true;
+    notifyListeners();
+}
+
+/**
+ * Tell listeners about the latest best if the rate limit allows.  Only called by the optimizing thread.
+ */
+void Die::notifyListeners() {
+    auto now = std::chrono::steady_clock::now();
+    if (now < _nextNotifyTime) return;
+    _notifyPending = false;
+    _nextNotifyTime = now + std::chrono::milliseconds(NOTIFY_INTERVAL_MS);
+
+    std::lock_guard<QMutex> lock(_listenerMutex);
+    if (_listeners.empty()) return;
+    double energy = _best.getTotalStress();
+    uint64_t version = _version.load();
+    for (auto& listener: _listeners) listener.second(energy, version);
+}
+
+/**
+ * Tell listeners about a best the rate limit held back, so it is not lost when this die stops being optimized.
+ * Only called by the optimizing thread.
+ */
+void Die::flushNotifications() {
+    if (!_notifyPending) return;
+    _nextNotifyTime = std::chrono::steady_clock::now();
+    notifyListeners();
+}
+
+/**
+ * Split this die's pair sums over a pool, for the one thread polishing the best while the others explore
+ * @param pool nullptr to sum on the optimizing thread
+ */
+void Die::setPool(ThreadPool* pool) {
+    _best.setPool(pool);
+    _current.setPool(pool);
+}
+
+/**
+ * Get told when this die finds a better configuration, at most every NOTIFY_INTERVAL_MS.  Listeners run on
+ * the optimizing thread so must be quick, and must not subscribe or unsubscribe on this die.
+ * @param listener
+ * @return id to unsubscribe with
+ */
+size_t Die::subscribe(Listener listener) {
+    std::lock_guard<QMutex> lock(_listenerMutex);
+    size_t id = _nextListenerId++;
+    _listeners.emplace_back(id, std::move(listener));
+    return id;
+}
+
+/**
+ * Stop a listener.  Once this returns the listener is not running and will not be called again.
+ * @param id
+ */
+void Die::unsubscribe(size_t id) {
+    std::lock_guard<QMutex> lock(_listenerMutex);
+    _listeners.erase(std::remove_if(_listeners.begin(), _listeners.end(),
+                                    [id](const pair<size_t, Listener>& listener) { return listener.first == id; }),
+                     _listeners.end());
+}
+
+/**
+ * Number of times the best configuration has changed
+ * @return
+ */
+uint64_t Die::getVersion() const {
+    return _version.load();
+}
+
+/**
+ * Moves since this die was made that gave a new best
+ * @return
+ */
+uint64_t Die::getAccepted() const {
+    return _accepted;
+}
+
+/**
+ * Moves since this die was made that did not beat best
+ * @return
+ */
+uint64_t Die::getRejected() const {
+    return _rejected;
+}
+
 /**
  * Return best point sphere
  * @return
@@ -103,6 +425,14 @@ PointSphere Die::getBest() const {
     return _best;
 }
 
+/**
+ * Return total stress of the best point sphere without copying or locking it, safe from any thread
+ * @return
+ */
+double Die::getBestStress() const {
+    return _bestStress.load();
+}
+
 void Die::draw(QPainter& painter, bool highlightExtremes) {
     const int horizontalPadding = 15;
 
@@ -215,129 +545,69 @@ void Die::reduceRate() {
     if (_moveRate < _moveRateMin) _moveRate = _moveRateMin;
 }
 
+/**
+ * Seconds since best last changed.  A time sliced die counts only the seconds it was worked on, so waiting for
+ * a turn does not look like being stuck.
+ * @return
+ */
 long Die::getSecondsSinceLastBest() const {
+    if (_timeSliced) return static_cast<long>(_workSeconds - _workSecondsAtBest);
     auto now = std::chrono::steady_clock::now();
     return std::chrono::duration_cast<std::chrono::seconds>(now - _lastBestTime).count();
 }
 
-void Die::pauseOptimization() {
-    _optimizationPaused = true;
+/**
+ * Count a slice of work given to this die by a scheduler.  From the first call on, the die's time since best is
+ * measured in work.  Only call from the thread optimizing the die, between slices.
+ * @param seconds
+ */
+void Die::addWorkSeconds(double seconds) {
+    _timeSliced = true;
+    _workSeconds += seconds;
 }
 
-void Die::resumeOptimization() {
-    _optimizationPaused = false;
+/**
+ * Record that best just changed
+ */
+void Die::markBestTime() {
+    _lastBestTime = std::chrono::steady_clock::now();
+    _workSecondsAtBest = _workSeconds;
 }
 
-bool Die::isOptimizationPaused() {
-    return _optimizationPaused;
+const OptimizerParams& Die::getParams() const {
+    return _params;
 }
 
-std::vector<size_t> Die::getLabels() {
-    if (!_labels.empty()) return _labels;
-
-    //labels not assigned so compute
-    int N = static_cast<int>(_best.sideCount());
-    std::vector<size_t> bestAssignment(N, 0);
-    double maxTotalDistance = -1.0;
-    const int numTrials = 100;  // Number of random guesses
-
-    // Seed the random number generator
-    srand(static_cast<unsigned int>(time(nullptr)));
-
-    for (int trial = 0; trial < numTrials; ++trial) {
-        std::vector<size_t> assignedLabels(N, 0);
-        std::vector<size_t> labelsToPoints(N + 1, 0);
-        std::vector<size_t> unassignedPoints(N);
-        for (int i = 0; i < N; ++i) {
-            unassignedPoints[i] = i;
-        }
-
-        //create a lambda to handle assigning points
-        auto assignLabel = [&assignedLabels, &labelsToPoints, &unassignedPoints, N](size_t randomIndex, size_t label) {
-            //get point index
-            size_t pointIndex = unassignedPoints[randomIndex];
-
-            //compute its opposite
-            size_t oppositeIndex = (2 * floor(pointIndex / 2) + (1 - pointIndex % 2));
-            size_t oppositeLabel = N + 1 - label;
-
-            //assign labels
-            assignedLabels[pointIndex] = label;
-            assignedLabels[oppositeIndex] = oppositeLabel;
-
-            //erase from unassigned list
-            unassignedPoints.erase(unassignedPoints.begin() + randomIndex);
-            if (randomIndex % 2 == 1) {
-                randomIndex--;
-            }    //if we deleted second index in set then set to delete first.  if we deleted first second will have moved to this index
-            unassignedPoints.erase(unassignedPoints.begin() + randomIndex);
-
-            //save label to points map
-            labelsToPoints[label] = pointIndex;
-            labelsToPoints[oppositeLabel] = oppositeIndex;
-
-            //returns selected index
-            return pointIndex;
-        };
-
-        // Randomly select starting point
-        int lastPointIndex = assignLabel(rand() % N, 1);
-
-        //assign labels
-        for (size_t label = 2; label <= N / 2; ++label) { //only do half because we assign 2 at a time
-            // Find all points between 90 and 180 degrees away
-            Vec3 lastPoint = _best.getPoint(lastPointIndex);
-            std::vector<int> candidatePoints;
-            double maxAngle = 0.0;
-            int furthestPointIndex = 0;
-            for (size_t i = 0; i < unassignedPoints.size(); i++) {
-                size_t idx = unassignedPoints[i];
-
-                Vec3 point = _best.getPoint(idx);
-                //compute angle and keep if in range
-                double angle = lastPoint.angle(point);
-                if (angle >= M_PI / 2 && angle < M_PI) {
-                    candidatePoints.push_back(i);
-                }
-                // Keep track of furthest point in case no candidate points
-                if (angle > maxAngle) {
-                    maxAngle = angle;
-                    furthestPointIndex = i;
-                }
-            }
-
-            //pick a point
-            int selectedPointIndex;
-            if (!candidatePoints.empty()) {
-                // Select random point from candidatePoints
-                int randomIndex = rand() % candidatePoints.size();
-                selectedPointIndex = candidatePoints[randomIndex];
-            } else {
-                // No points between 90 and 180 degrees, select furthest point
-                selectedPointIndex = furthestPointIndex;
-            }
-
-            lastPointIndex = assignLabel(selectedPointIndex, label);
-        }
-
-        // Compute total distance between consecutively labeled points
-        double totalDistance = 0.0;
-        for (int l = 1; l < N; ++l) {
-            int idx1 = labelsToPoints[l];
-            int idx2 = labelsToPoints[l + 1];
-            Vec3 point1 = _best.getPoint(idx1);
-            Vec3 point2 = _best.getPoint(idx2);
-            totalDistance += point1.distance(point2);
-        }
-
-        if (totalDistance > maxTotalDistance) {
-            maxTotalDistance = totalDistance;
-            bestAssignment = assignedLabels;
+/**
+ * Side labels of a copy of best.  Labels are made in file order, so a configuration gets the same labels
+ * however its points are ordered in memory.  They are kept for as long as the points stay the same and saved
+ * next to the best result, so a die labelled once, by any run, is not labelled again.
+ * @param best
+ * @return label of each side index of best
+ */
+std::vector<size_t> Die::getLabels(const PointSphere& best) {
+    vector<Vec3> points = best.externalPoints();
+    uint64_t hash = Checkpoint::fnv1a(points.data(), points.size() * sizeof(Vec3));
+
+    vector<size_t> labels;
+    {
+        std::lock_guard<QMutex> lock(_labelMutex);
+        if (hash == _labelsHash) labels = _labels;
+    }
+    if (labels.empty()) {
+        labels = LabelFile::read(best.sideCount(), hash);
+        if (labels.empty()) {
+            labels = Labeler(points).run(LABEL_TRIALS);
+            LabelFile::write(best.sideCount(), hash, labels);
         }
+        std::lock_guard<QMutex> lock(_labelMutex);
+        _labels = labels;
+        _labelsHash = hash;
     }
-    _labels = bestAssignment;
 
-    return _labels;
+    vector<size_t> result(best.sideCount());
+    for (size_t side = 0; side < result.size(); ++side) result[side] = labels[best.externalSide(side)];
+    return result;
 }
 
 void Die::save() {
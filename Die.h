@@ -9,43 +9,98 @@
 #include <vector>
 #include "Vec3.h"
 #include <chrono>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <random>
+#include <QMutex>
 #include <QPainter>
 #include "PointSphere.h"
-
-//1 in RANDOM_RATE optimizations will be of random point rest will be on max stress
-#define RANDOM_RATE 2
-
-#define REDUCE_RATE 30
+#include "OptimizerParams.h"
 
 using namespace std;
 
 class Die {
+public:
+    //called with the new best energy and version, on the thread optimizing the die
+    using Listener = function<void(double energy, uint64_t version)>;
+
+private:
     double _moveRate;
     double _moveRateMin;
     PointSphere _best;
     PointSphere _current;
     std::chrono::steady_clock::time_point _lastBestTime;
-    long _nextReduceTime = REDUCE_RATE;
-    static bool _optimizationPaused;
-    vector<size_t> _labels;
+    bool _timeSliced = false;           //only runs while a scheduler gives it time, so time is counted in work
+    double _workSeconds = 0;            //seconds of work given so far when time sliced
+    double _workSecondsAtBest = 0;
+    OptimizerParams _params;
+    long _nextReduceTime;
+    mutable QMutex _labelMutex;         //guards _labels and _labelsHash, labels are asked for from other threads
+    vector<size_t> _labels;             //label of each side in file order
+    uint64_t _labelsHash = 0;           //hash of the points _labels were made for
     size_t _lastOptimizedIndex = 0;
+    vector<size_t> _changedPoints;      //points in _current that differ from _best
+    vector<bool> _pointChanged;
+    size_t _continuationStage;          //index into the annealing exponents, done once it reaches the last
+    size_t _continuationMoves = 0;
+    size_t _movesSinceReorder = 0;
+    mt19937 _rng;                       //own generator so a saved run state carries on with the same moves
+    uint64_t _accepted = 0;             //moves that improved on best
+    uint64_t _rejected = 0;             //moves that did not
+
+    QMutex _offerMutex;                 //guards _offered, which other threads hand in
+    std::unique_ptr<PointSphere> _offered;
+    double _offeredRate = 0;
+    std::atomic<bool> _hasOffer{false};
+
+    QMutex _listenerMutex;              //guards _listeners, held while they are called
+    vector<pair<size_t, Listener>> _listeners;
+    size_t _nextListenerId = 1;
+    std::atomic<uint64_t> _version{0};  //bumped every time _best changes
+    std::atomic<double> _bestStress;    //energy of _best, published so other threads can read it without a lock
+    bool _notifyPending = false;
+    std::chrono::steady_clock::time_point _nextNotifyTime;
+
+    void markChanged(size_t sideIndex);
+    void markBestTime();
+    void advanceContinuation();
+    void adoptOffer();
+    void reorderPoints();
+    void bestChanged();
+    void notifyListeners();
 
 public:
     Die(size_t sides, bool loadBest = false);
+    Die(size_t sides, bool loadBest, const OptimizerParams& params);
+    Die(size_t sides, bool loadBest, const OptimizerParams& params, unsigned int seed);
+    Die(size_t sides, RunState::Reader& state);
     void optimize();
     PointSphere getBest() const;
+    void offer(const Die& other);
+    void offer(const PointSphere& candidate, double rate);
+    double getMoveRate() const;
+    double getBestStress() const;
     void reduceRate();
     long getSecondsSinceLastBest() const;
+    void addWorkSeconds(double seconds);
+    const OptimizerParams& getParams() const;
+    uint64_t getVersion() const;
+    uint64_t getAccepted() const;
+    uint64_t getRejected() const;
+
+    size_t subscribe(Listener listener);
+    void unsubscribe(size_t id);
+    void flushNotifications();
+    void setPool(ThreadPool* pool);
 
-    static void pauseOptimization();
-    static void resumeOptimization();
-    static bool isOptimizationPaused();
 
     void save();
+    void writeState(RunState::Writer& state) const;
 
 
     void draw(QPainter& img, bool highlightExtremes = true);
-    vector<size_t> getLabels();
+    vector<size_t> getLabels(const PointSphere& best);
 };
 
 
@@ -0,0 +1,150 @@
+#include "DieRegistry.h"
+#include <algorithm>
+#include <limits>
+#include <mutex>
+
+DieRegistry::~DieRegistry() {
+    clear();
+}
+
+/**
+ * Change the number of slots.  Dies in removed slots are deleted, new slots start empty.
+ * @param slotCount
+ */
+void DieRegistry::resize(size_t slotCount) {
+    unique_ptr<std::atomic<Die*>[]> dies(new std::atomic<Die*>[slotCount]);
+    for (size_t i = 0; i < slotCount; ++i) dies[i].store(i < _size ? _dies[i].load() : nullptr);
+    for (size_t i = slotCount; i < _size; ++i) delete _dies[i].load();
+    _dies = std::move(dies);
+    _size = slotCount;
+
+    //nothing reads the registry now, so dies retired by replace can go as well
+    EpochReclaimer::instance().drain();
+}
+
+/**
+ * Delete all dies and remove all slots
+ */
+void DieRegistry::clear() {
+    resize(0);
+}
+
+/**
+ * Number of slots
+ * @return
+ */
+size_t DieRegistry::size() const {
+    return _size;
+}
+
+/**
+ * Slot used by the thread that keeps optimizing the best result
+ * @return
+ */
+size_t DieRegistry::bestSlot() const {
+    return _size - 1;
+}
+
+/**
+ * Die in a slot, may be nullptr
+ * @param slot
+ * @return
+ */
+Die* DieRegistry::get(size_t slot) const {
+    return _dies[slot].load();
+}
+
+/**
+ * Put a die in a slot.  Whatever was there is deleted once no reader can still be using it.
+ * @param slot
+ * @param die
+ */
+void DieRegistry::replace(size_t slot, Die* die) {
+    if (die != nullptr && die != _dies[slot].load()) {
+        die->subscribe([this](double energy, uint64_t version) { improved(energy, version); });
+    }
+    Die* old = _dies[slot].exchange(die);
+    if (old != nullptr && old != die) EpochReclaimer::instance().retire(old);
+}
+
+/**
+ * Slot of the die with the lowest best stress
+ * @return size() if no slot has a die yet
+ */
+size_t DieRegistry::bestIndex() const {
+    EpochGuard guard;
+    size_t bestIndex = _size;
+    double bestStress = numeric_limits<double>::max();
+    for (size_t i = 0; i < _size; ++i) {
+        Die* die = _dies[i].load();
+        if (die == nullptr) continue;
+        double stress = die->getBestStress();
+        if (stress < bestStress) {
+            bestStress = stress;
+            bestIndex = i;
+        }
+    }
+    return bestIndex;
+}
+
+/**
+ * Die with the lowest best stress
+ * @return nullptr if no slot has a die yet
+ */
+Die* DieRegistry::best() const {
+    EpochGuard guard;
+    Die* best = nullptr;
+    double bestStress = numeric_limits<double>::max();
+    for (size_t i = 0; i < _size; ++i) {
+        Die* die = _dies[i].load();
+        if (die == nullptr) continue;
+        double stress = die->getBestStress();
+        if (stress < bestStress) {
+            bestStress = stress;
+            best = die;
+        }
+    }
+    return best;
+}
+
+/**
+ * Get told whenever any die in the registry finds a better configuration.  Same rules as Die::subscribe.
+ * @param listener
+ * @return id to unsubscribe with
+ */
+size_t DieRegistry::subscribe(Die::Listener listener) {
+    std::lock_guard<QMutex> lock(_listenerMutex);
+    size_t id = _nextListenerId++;
+    _listeners.emplace_back(id, std::move(listener));
+    return id;
+}
+
+/**
+ * Stop a listener.  Once this returns the listener is not running and will not be called again.
+ * @param id
+ */
+void DieRegistry::unsubscribe(size_t id) {
+    std::lock_guard<QMutex> lock(_listenerMutex);
+    _listeners.erase(std::remove_if(_listeners.begin(), _listeners.end(),
+                                    [id](const pair<size_t, Die::Listener>& listener) { return listener.first == id; }),
+                     _listeners.end());
+}
+
+/**
+ * Number of new bests reported by all dies so far, so a saver can tell if anything changed
+ * @return
+ */
+uint64_t DieRegistry::improvementCount() const {
+    return _improvements.load();
+}
+
+/**
+ * Pass a die's notification on to the registry's listeners
+ * @param energy
+ * @param version
+ */
+void DieRegistry::improved(double energy, uint64_t version) {
+    _improvements.fetch_add(1);
+    std::lock_guard<QMutex> lock(_listenerMutex);
+    for (auto& listener: _listeners) listener.second(energy, version);
+}
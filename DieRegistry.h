@@ -0,0 +1,56 @@
+#ifndef DICE_DIEREGISTRY_H
+#define DICE_DIEREGISTRY_H
+
+#include <atomic>
+#include <memory>
+#include <QMutex>
+#include "Die.h"
+#include "EpochReclaimer.h"
+
+using namespace std;
+
+/**
+ * Holds the die each worker is optimizing.  The last slot belongs to the thread polishing the best result.
+ * Sized at runtime so the worker count is not fixed at compile time.
+ *
+ * Slots are published atomically and replaced dies are retired through EpochReclaimer, so reading never
+ * takes a lock.  A pointer from get or best may only be used while the calling thread holds an EpochGuard,
+ * unless the caller is the thread that owns that slot.  resize and clear must not run while other threads
+ * use the registry.
+ *
+ * Listeners subscribed here hear about new bests from every die that is or later gets put in a slot.
+ */
+class DieRegistry {
+    unique_ptr<std::atomic<Die*>[]> _dies;
+    size_t _size = 0;
+
+    mutable QMutex _listenerMutex;
+    vector<pair<size_t, Die::Listener>> _listeners;
+    size_t _nextListenerId = 1;
+    std::atomic<uint64_t> _improvements{0};
+
+    void improved(double energy, uint64_t version);
+
+public:
+    DieRegistry() = default;
+    DieRegistry(const DieRegistry&) = delete;
+    DieRegistry& operator=(const DieRegistry&) = delete;
+    ~DieRegistry();
+
+    void resize(size_t slotCount);
+    void clear();
+    size_t size() const;
+    size_t bestSlot() const;
+
+    Die* get(size_t slot) const;
+    void replace(size_t slot, Die* die);
+
+    size_t bestIndex() const;
+    Die* best() const;
+
+    size_t subscribe(Die::Listener listener);
+    void unsubscribe(size_t id);
+    uint64_t improvementCount() const;
+};
+
+#endif //DICE_DIEREGISTRY_H
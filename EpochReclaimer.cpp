@@ -0,0 +1,139 @@
+#include "EpochReclaimer.h"
+#include <thread>
+
+//retired objects gathered before trying to free some
+#define COLLECT_THRESHOLD 8
+
+namespace {
+    /**
+     * Gives each thread its own record the first time it reads and hands it back when the thread exits
+     */
+    struct ThreadRecord {
+        EpochReclaimer::Record* record = nullptr;
+
+        EpochReclaimer::Record* get() {
+            if (record == nullptr) record = EpochReclaimer::instance().acquireRecord();
+            return record;
+        }
+
+        ~ThreadRecord() {
+            if (record != nullptr) EpochReclaimer::instance().releaseRecord(record);
+        }
+    };
+
+    thread_local ThreadRecord threadRecord;
+}
+
+/**
+ * Reclaimer shared by the whole program
+ * @return
+ */
+EpochReclaimer& EpochReclaimer::instance() {
+    static EpochReclaimer reclaimer;
+    return reclaimer;
+}
+
+/**
+ * Reuse a record a finished thread gave back or add a new one.  Records are never freed so the scan in
+ * tryAdvance can walk the list without locking.
+ * @return
+ */
+EpochReclaimer::Record* EpochReclaimer::acquireRecord() {
+    for (Record* record = _records.load(); record != nullptr; record = record->next) {
+        bool expected = false;
+        if (record->inUse.compare_exchange_strong(expected, true)) return record;
+    }
+    auto* record = new Record();
+    record->next = _records.load();
+    while (!_records.compare_exchange_weak(record->next, record)) {}
+    return record;
+}
+
+/**
+ * @param record no longer used by its thread
+ */
+void EpochReclaimer::releaseRecord(Record* record) {
+    record->depth = 0;
+    record->epoch.store(0);
+    record->inUse.store(false);
+}
+
+/**
+ * Start reading.  Publishing the epoch before any shared pointer is loaded is what keeps those objects alive.
+ * @param record
+ */
+void EpochReclaimer::enter(Record* record) {
+    if (record->depth++ > 0) return;
+    record->epoch.store(_epoch.load());
+}
+
+/**
+ * @param record
+ */
+void EpochReclaimer::leave(Record* record) {
+    if (--record->depth > 0) return;
+    record->epoch.store(0);
+}
+
+/**
+ * Move to the next epoch if every thread that is reading has seen the current one
+ * @return true if the epoch moved
+ */
+bool EpochReclaimer::tryAdvance() {
+    uint64_t current = _epoch.load();
+    for (Record* record = _records.load(); record != nullptr; record = record->next) {
+        uint64_t epoch = record->epoch.load();
+        if (epoch != 0 && epoch != current) return false;
+    }
+    return _epoch.compare_exchange_strong(current, current + 1);
+}
+
+/**
+ * Delete retired objects no reader can still hold.  Anything retired two epochs ago is safe because every
+ * reader has since left the epoch it was unlinked in.  Called with _retiredMutex held.
+ */
+void EpochReclaimer::collect() {
+    tryAdvance();
+    uint64_t safe = _epoch.load();
+    size_t kept = 0;
+    for (auto& retired: _retired) {
+        if (retired.epoch + 2 <= safe) {
+            retired.destroy();
+        } else {
+            _retired[kept++] = std::move(retired);
+        }
+    }
+    _retired.resize(kept);
+}
+
+/**
+ * Hand over an object that has already been unlinked from shared state
+ * @param destroy frees the object once no reader can see it
+ */
+void EpochReclaimer::retire(function<void()> destroy) {
+    std::lock_guard<std::mutex> lock(_retiredMutex);
+    _retired.push_back({_epoch.load(), std::move(destroy)});
+    if (_retired.size() >= COLLECT_THRESHOLD) collect();
+}
+
+/**
+ * Free everything retired so far, waiting for readers to finish.  The calling thread must not hold a guard.
+ */
+void EpochReclaimer::drain() {
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(_retiredMutex);
+            collect();
+            if (_retired.empty()) return;
+        }
+        std::this_thread::yield();
+    }
+}
+
+EpochGuard::EpochGuard() : _record(threadRecord.get()) {
+    EpochReclaimer::instance().enter(_record);
+}
+
+EpochGuard::~EpochGuard() {
+    EpochReclaimer::instance().leave(_record);
+}
@@ -0,0 +1,71 @@
+#ifndef DICE_EPOCHRECLAIMER_H
+#define DICE_EPOCHRECLAIMER_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Epoch based reclamation.  Readers hold an EpochGuard while they use a pointer they loaded from shared
+ * state, writers unlink an object and retire it, and it is only deleted once every reader that could still
+ * see it has dropped its guard.  Taking a guard is a couple of atomic operations and never waits on writers.
+ */
+class EpochReclaimer {
+public:
+    struct Record {
+        std::atomic<uint64_t> epoch{0};     //epoch the thread is reading in, 0 when not reading
+        std::atomic<bool> inUse{true};
+        Record* next = nullptr;
+        unsigned int depth = 0;             //nested guards, only touched by the owning thread
+    };
+
+private:
+    struct Retired {
+        uint64_t epoch;
+        function<void()> destroy;
+    };
+
+    std::atomic<uint64_t> _epoch{1};
+    std::atomic<Record*> _records{nullptr};
+    std::mutex _retiredMutex;
+    vector<Retired> _retired;
+
+    EpochReclaimer() = default;
+    bool tryAdvance();
+    void collect();
+
+public:
+    static EpochReclaimer& instance();
+
+    Record* acquireRecord();
+    void releaseRecord(Record* record);
+    void enter(Record* record);
+    void leave(Record* record);
+
+    void retire(function<void()> destroy);
+    void drain();
+
+    template<class T>
+    void retire(T* object) {
+        retire([object]() { delete object; });
+    }
+};
+
+/**
+ * Marks the calling thread as reading shared pointers until it goes out of scope.  Guards nest.
+ */
+class EpochGuard {
+    EpochReclaimer::Record* _record;
+
+public:
+    EpochGuard();
+    ~EpochGuard();
+    EpochGuard(const EpochGuard&) = delete;
+    EpochGuard& operator=(const EpochGuard&) = delete;
+};
+
+#endif //DICE_EPOCHRECLAIMER_H
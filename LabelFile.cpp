@@ -0,0 +1,85 @@
+#include "LabelFile.h"
+#include "AtomicFile.h"
+#include "Checkpoint.h"
+#include "MappedFile.h"
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+
+namespace {
+    std::mutex writeMutex;      //two windows labelling the same die must not share a temporary file
+
+    /**
+     * Checksum of a header and its labels
+     * @param header checksum field is ignored
+     * @param labels
+     * @param count
+     * @return
+     */
+    uint64_t checksum(const LabelFile::Header& header, const uint32_t* labels, size_t count) {
+        LabelFile::Header copy = header;
+        copy.checksum = 0;
+        uint64_t hash = Checkpoint::fnv1a(&copy, sizeof(copy));
+        return Checkpoint::fnv1a(labels, count * sizeof(uint32_t), hash);
+    }
+}
+
+/**
+ * Path of a side count's labels
+ * @param sideCount
+ * @return
+ */
+string LabelFile::filename(size_t sideCount) {
+    return "best/" + to_string(sideCount) + ".labels";
+}
+
+/**
+ * Saved labels of a side count if they were made for these points
+ * @param sideCount
+ * @param pointsHash
+ * @return label of each side in file order, empty if there are none or they are for other points
+ */
+vector<size_t> LabelFile::read(size_t sideCount, uint64_t pointsHash) {
+    MappedFile file(filename(sideCount));
+    if (!file.isOpen() || file.size() != sizeof(Header) + sideCount * sizeof(uint32_t)) return {};
+
+    Header header{};
+    memcpy(&header, file.data(), sizeof(header));
+    if (memcmp(header.magic, LABEL_MAGIC, sizeof(header.magic)) != 0 || header.version != LABEL_VERSION) return {};
+    if (header.sideCount != sideCount || header.pointsHash != pointsHash) return {};
+    vector<uint32_t> stored(sideCount);
+    memcpy(stored.data(), file.data() + sizeof(Header), sideCount * sizeof(uint32_t));
+    if (checksum(header, stored.data(), stored.size()) != header.checksum) return {};
+
+    //must be every label once with opposite sides adding up to N + 1
+    vector<bool> seen(sideCount + 1, false);
+    for (size_t side = 0; side < sideCount; ++side) {
+        uint32_t label = stored[side];
+        if (label == 0 || label > sideCount || seen[label] || label + stored[side ^ 1] != sideCount + 1) return {};
+        seen[label] = true;
+    }
+    return {stored.begin(), stored.end()};
+}
+
+/**
+ * Save the labels of a side count, replacing any made for other points
+ * @param sideCount
+ * @param pointsHash
+ * @param labels label of each side in file order
+ * @return false if the file could not be written
+ */
+bool LabelFile::write(size_t sideCount, uint64_t pointsHash, const vector<size_t>& labels) {
+    vector<uint32_t> stored(labels.begin(), labels.end());
+    Header header{};
+    memcpy(header.magic, LABEL_MAGIC, sizeof(header.magic));
+    header.version = LABEL_VERSION;
+    header.sideCount = sideCount;
+    header.pointsHash = pointsHash;
+    header.checksum = checksum(header, stored.data(), stored.size());
+
+    string bytes(reinterpret_cast<const char*>(&header), sizeof(header));
+    bytes.append(reinterpret_cast<const char*>(stored.data()), stored.size() * sizeof(uint32_t));
+    std::lock_guard<std::mutex> lock(writeMutex);
+    std::filesystem::create_directories("best");
+    return AtomicFile::write(filename(sideCount), bytes);
+}
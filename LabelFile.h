@@ -0,0 +1,36 @@
+#ifndef DICE_LABELFILE_H
+#define DICE_LABELFILE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+//first bytes of every label file
+#define LABEL_MAGIC "DLAB"
+
+//bumped whenever the layout changes, older versions are rejected
+#define LABEL_VERSION 1
+
+/**
+ * Side labels of a best result, saved as best/<sides>.labels so a die that was labelled once is never
+ * labelled again.  Labels are stored in file order and keyed by a hash of the points they were made for, so
+ * they are ignored as soon as the saved points change.  Files are little endian.
+ */
+class LabelFile {
+public:
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint64_t sideCount;
+        uint64_t pointsHash;    //FNV-1a of the points in file order
+        uint64_t checksum;      //FNV-1a of the header with this field zeroed, then the labels
+    };
+
+    static string filename(size_t sideCount);
+    static vector<size_t> read(size_t sideCount, uint64_t pointsHash);
+    static bool write(size_t sideCount, uint64_t pointsHash, const vector<size_t>& labels);
+};
+
+#endif //DICE_LABELFILE_H
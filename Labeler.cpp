@@ -0,0 +1,263 @@
+#include "Labeler.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+
+//pairs kept in each neighbour list
+#define NEIGHBOUR_COUNT 12
+
+//rows of the neighbour table built per block
+#define NEIGHBOUR_BLOCK_ROWS 64
+
+//amount of kick work per trial, divided by the pair count so big dice get fewer kicks
+#define KICK_WORK 100000
+
+//most kicks per pair, small dice are solved long before KICK_WORK runs out
+#define KICKS_PER_PAIR 16
+
+//smallest gain a move must make, stops rounding noise from looping forever
+#define MIN_GAIN 1e-12
+
+/**
+ * Build the neighbour table, the only part that looks at every pair of points
+ * @param points one per mirror pair
+ */
+Labeler::Labeler(const vector<Vec3>& points) : _pairCount(points.size()), _points(points) {
+    _neighbourCount = std::min<size_t>(NEIGHBOUR_COUNT, _pairCount > 0 ? _pairCount - 1 : 0);
+    _neighbours.resize(_pairCount * _neighbourCount);
+    size_t blocks = (_pairCount + NEIGHBOUR_BLOCK_ROWS - 1) / NEIGHBOUR_BLOCK_ROWS;
+    ThreadPool::instance().parallelFor(blocks, [this](size_t block) {
+        vector<pair<double, uint32_t>> candidates;
+        size_t end = std::min(_pairCount, (block + 1) * NEIGHBOUR_BLOCK_ROWS);
+        for (size_t i = block * NEIGHBOUR_BLOCK_ROWS; i < end; ++i) {
+            candidates.clear();
+            for (size_t j = 0; j < _pairCount; ++j) {
+                if (j != i) candidates.emplace_back(-fabs(_points[i].dot(_points[j])), static_cast<uint32_t>(j));
+            }
+            std::partial_sort(candidates.begin(), candidates.begin() + _neighbourCount, candidates.end());
+            for (size_t k = 0; k < _neighbourCount; ++k) {
+                _neighbours[i * _neighbourCount + k] = candidates[k].second;
+            }
+        }
+    });
+}
+
+/**
+ * Longest step between two pairs when each can use either of its points
+ * @param a
+ * @param b
+ * @return
+ */
+double Labeler::weight(uint32_t a, uint32_t b) const {
+    return sqrt(2 + 2 * fabs(_points[a].dot(_points[b])));
+}
+
+/**
+ * Total length of a path through the pairs
+ * @param order
+ * @return
+ */
+double Labeler::length(const vector<uint32_t>& order) const {
+    double total = 0;
+    for (size_t i = 1; i < order.size(); ++i) total += weight(order[i - 1], order[i]);
+    return total;
+}
+
+/**
+ * Path that always steps to the unused pair it can get furthest from, sometimes taking the second furthest
+ * so trials differ
+ * @param rng
+ * @return
+ */
+vector<uint32_t> Labeler::greedy(mt19937& rng) const {
+    vector<uint32_t> unused(_pairCount);
+    vector<uint32_t> slot(_pairCount);     //index of each pair in unused
+    for (uint32_t i = 0; i < _pairCount; ++i) unused[i] = slot[i] = i;
+    auto take = [&](uint32_t pair) {
+        uint32_t last = unused.back();
+        unused[slot[pair]] = last;
+        slot[last] = slot[pair];
+        unused.pop_back();
+        slot[pair] = UINT32_MAX;
+    };
+
+    vector<uint32_t> order;
+    order.reserve(_pairCount);
+    uint32_t current = rng() % _pairCount;
+    take(current);
+    order.push_back(current);
+    while (!unused.empty()) {
+        //neighbour lists are sorted, so the first unused ones are the furthest steps
+        uint32_t next = UINT32_MAX;
+        bool skipFirst = rng() % 4 == 0;
+        for (size_t k = 0; k < _neighbourCount; ++k) {
+            uint32_t candidate = _neighbours[current * _neighbourCount + k];
+            if (slot[candidate] == UINT32_MAX) continue;
+            next = candidate;
+            if (!skipFirst) break;
+            skipFirst = false;
+        }
+
+        //whole neighbourhood used, look at everything that is left
+        if (next == UINT32_MAX) {
+            double best = -1;
+            for (uint32_t candidate: unused) {
+                double step = fabs(_points[current].dot(_points[candidate]));
+                if (step > best) {
+                    best = step;
+                    next = candidate;
+                }
+            }
+        }
+        take(next);
+        order.push_back(next);
+        current = next;
+    }
+    return order;
+}
+
+/**
+ * 2-opt until no reversal through a neighbour list lengthens the path.  Only pairs in the queue are looked at
+ * and the ends of every changed step are queued again, so after a kick only the area around it is searched.
+ * @param order
+ * @param position index of each pair in order
+ * @param queue
+ * @param queued
+ */
+void Labeler::improve(vector<uint32_t>& order, vector<uint32_t>& position, vector<uint32_t>& queue,
+                      vector<bool>& queued) const {
+    const long last = static_cast<long>(_pairCount) - 1;
+
+    //gain of reversing order[p + 1 .. q], p may be -1 and q may be the last index
+    auto gain = [&](long p, long q) {
+        double result = 0;
+        if (p >= 0) result += weight(order[p], order[q]) - weight(order[p], order[p + 1]);
+        if (q < last) result += weight(order[p + 1], order[q + 1]) - weight(order[q], order[q + 1]);
+        return result;
+    };
+    auto push = [&](long index) {
+        if (index < 0 || index > last || queued[order[index]]) return;
+        queued[order[index]] = true;
+        queue.push_back(order[index]);
+    };
+
+    while (!queue.empty()) {
+        uint32_t pair = queue.back();
+        queue.pop_back();
+        queued[pair] = false;
+
+        long i = position[pair];
+        for (size_t k = 0; k < _neighbourCount; ++k) {
+            long j = position[_neighbours[pair * _neighbourCount + k]];
+
+            //the two reversals that make pair and its neighbour adjacent
+            long moves[2][2];
+            if (j > i) {
+                moves[0][0] = i, moves[0][1] = j;
+                moves[1][0] = i - 1, moves[1][1] = j - 1;
+            } else {
+                moves[0][0] = j - 1, moves[0][1] = i - 1;
+                moves[1][0] = j, moves[1][1] = i;
+            }
+            bool moved = false;
+            for (auto& move: moves) {
+                long p = move[0], q = move[1];
+                if (q - p < 2 || gain(p, q) <= MIN_GAIN) continue;
+                std::reverse(order.begin() + p + 1, order.begin() + q + 1);
+                for (long index = p + 1; index <= q; ++index) position[order[index]] = index;
+                push(p);
+                push(p + 1);
+                push(q);
+                push(q + 1);
+                moved = true;
+                break;
+            }
+            if (moved) break;
+        }
+    }
+}
+
+/**
+ * One greedy start followed by local search and kicks.  A kick swaps two neighbouring stretches of the path,
+ * which 2-opt cannot undo, and is kept only if the search after it ends up longer.
+ * @param seed
+ * @param order set to the path found
+ * @return its length
+ */
+double Labeler::trial(size_t seed, vector<uint32_t>& order) const {
+    mt19937 rng(static_cast<unsigned int>(seed));
+    order = greedy(rng);
+    vector<uint32_t> position(_pairCount);
+    for (uint32_t i = 0; i < _pairCount; ++i) position[order[i]] = i;
+    vector<uint32_t> queue(order.rbegin(), order.rend());
+    vector<bool> queued(_pairCount, true);
+    improve(order, position, queue, queued);
+    double best = length(order);
+    if (_pairCount < 8) return best;
+
+    size_t kicks = std::max<size_t>(8, std::min<size_t>(KICK_WORK / _pairCount, KICKS_PER_PAIR * _pairCount));
+    vector<uint32_t> saved;
+    for (size_t kick = 0; kick < kicks; ++kick) {
+        saved = order;
+
+        //cut into a b c d and put back as a c b d
+        size_t cuts[3];
+        for (auto& cut: cuts) cut = 1 + rng() % (_pairCount - 1);
+        std::sort(cuts, cuts + 3);
+        if (cuts[0] == cuts[1] || cuts[1] == cuts[2]) continue;
+        std::rotate(order.begin() + cuts[0], order.begin() + cuts[1], order.begin() + cuts[2]);
+        for (size_t index = cuts[0]; index < cuts[2]; ++index) position[order[index]] = index;
+        size_t seams[] = {cuts[0] - 1, cuts[0], cuts[0] + cuts[2] - cuts[1] - 1, cuts[0] + cuts[2] - cuts[1],
+                          cuts[2] - 1, cuts[2]};
+        for (size_t seam: seams) {
+            if (seam < _pairCount && !queued[order[seam]]) {
+                queued[order[seam]] = true;
+                queue.push_back(order[seam]);
+            }
+        }
+        improve(order, position, queue, queued);
+
+        double result = length(order);
+        if (result > best + MIN_GAIN) {
+            best = result;
+        } else {
+            order = saved;
+            for (uint32_t i = 0; i < _pairCount; ++i) position[order[i]] = i;
+        }
+    }
+    return best;
+}
+
+/**
+ * Label every side.  Trials are spread over the thread pool, each with its own fixed seed, and the longest is
+ * kept with ties going to the earliest trial, so the result never depends on the thread count.
+ * @param trials
+ * @return label (1 to N) of each side index, side 2i is point i and side 2i + 1 its mirror image
+ */
+vector<size_t> Labeler::run(size_t trials) const {
+    size_t sideCount = _pairCount * 2;
+    vector<size_t> labels(sideCount, 0);
+    if (_pairCount == 0) return labels;
+
+    vector<vector<uint32_t>> orders(trials);
+    vector<double> lengths(trials);
+    ThreadPool::instance().parallelFor(trials, [&](size_t t) {
+        lengths[t] = trial(t, orders[t]);
+    });
+    size_t best = 0;
+    for (size_t t = 1; t < trials; ++t) {
+        if (lengths[t] > lengths[best]) best = t;
+    }
+
+    //pick the point of each pair that makes every step the long way round
+    const vector<uint32_t>& order = orders[best];
+    bool mirrored = false;
+    for (size_t k = 0; k < _pairCount; ++k) {
+        if (k > 0 && _points[order[k - 1]].dot(_points[order[k]]) >= 0) mirrored = !mirrored;
+        size_t side = order[k] * 2 + (mirrored ? 1 : 0);
+        size_t opposite = side ^ 1;
+        labels[side] = k + 1;
+        labels[opposite] = sideCount - k;
+    }
+    return labels;
+}
@@ -0,0 +1,36 @@
+#ifndef DICE_LABELER_H
+#define DICE_LABELER_H
+
+#include <cstdint>
+#include <random>
+#include <vector>
+#include "Vec3.h"
+
+using namespace std;
+
+/**
+ * Numbers the sides of a die so consecutive numbers sit far apart.  Opposite sides add up to N + 1, so labels
+ * 1 to N/2 pick one side of each mirror pair and the rest follow.  The sum of distances between consecutive
+ * labels is then 2 + twice the length of the path through the first half, and for a given order of pairs
+ * every step can take the longer of its two sign choices, |a - b| = sqrt(2 + 2|a.b|).  What is left is finding
+ * the longest path through the pairs, done by greedy starts improved with 2-opt and random kicks.
+ */
+class Labeler {
+    size_t _pairCount;
+    vector<Vec3> _points;               //one per mirror pair
+    size_t _neighbourCount;
+    vector<uint32_t> _neighbours;       //for each pair the pairs it makes the longest steps with, longest first
+
+    double weight(uint32_t a, uint32_t b) const;
+    double length(const vector<uint32_t>& order) const;
+    vector<uint32_t> greedy(mt19937& rng) const;
+    void improve(vector<uint32_t>& order, vector<uint32_t>& position, vector<uint32_t>& queue,
+                 vector<bool>& queued) const;
+    double trial(size_t seed, vector<uint32_t>& order) const;
+
+public:
+    explicit Labeler(const vector<Vec3>& points);
+    vector<size_t> run(size_t trials) const;
+};
+
+#endif //DICE_LABELER_H
@@ -0,0 +1,56 @@
+#include "MappedFile.h"
+#include <fstream>
+#include <iterator>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Open a file, leaves it closed if it does not exist or is empty
+ * @param filename
+ */
+MappedFile::MappedFile(const string& filename) {
+#ifndef _WIN32
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    struct stat info{};
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        void* mapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED) {
+            _data = static_cast<const unsigned char*>(mapping);
+            _size = static_cast<size_t>(info.st_size);
+            _mapped = true;
+        }
+    }
+    close(fd);
+#else
+    ifstream inFile(filename, ios::binary);
+    if (!inFile.is_open()) return;
+    _buffer.assign(istreambuf_iterator<char>(inFile), istreambuf_iterator<char>());
+    if (_buffer.empty()) return;
+    _data = _buffer.data();
+    _size = _buffer.size();
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+    if (_mapped) munmap(const_cast<unsigned char*>(_data), _size);
+#endif
+}
+
+bool MappedFile::isOpen() const {
+    return _data != nullptr;
+}
+
+const unsigned char* MappedFile::data() const {
+    return _data;
+}
+
+size_t MappedFile::size() const {
+    return _size;
+}
@@ -0,0 +1,29 @@
+#ifndef DICE_MAPPEDFILE_H
+#define DICE_MAPPEDFILE_H
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Read only view of a whole file.  Memory mapped where the platform allows, otherwise read into memory.
+ */
+class MappedFile {
+    const unsigned char* _data = nullptr;
+    size_t _size = 0;
+    vector<unsigned char> _buffer;     //file contents where memory mapping is not available
+    bool _mapped = false;
+
+public:
+    explicit MappedFile(const string& filename);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool isOpen() const;
+    const unsigned char* data() const;
+    size_t size() const;
+};
+
+#endif //DICE_MAPPEDFILE_H
@@ -0,0 +1,71 @@
+#include "MigrationHub.h"
+#include <mutex>
+
+/**
+ * Create a hub for a group of workers
+ * @param workerCount
+ * @param settings
+ */
+MigrationHub::MigrationHub(size_t workerCount, const Settings& settings)
+        : _settings(settings), _islands(workerCount), _rng(std::random_device()()) {
+    auto now = std::chrono::steady_clock::now();
+    for (auto& island: _islands) island.lastExchange = now;
+}
+
+/**
+ * Forget what a worker posted, used when it restarts on a new die
+ * @param worker
+ */
+void MigrationHub::reset(size_t worker) {
+    std::lock_guard<QMutex> lock(_mtx);
+    _islands[worker].best.reset();
+    _islands[worker].energy = numeric_limits<double>::infinity();
+    _islands[worker].lastExchange = std::chrono::steady_clock::now();
+}
+
+/**
+ * Post the worker's best and maybe take a neighbour's.  Cheap to call often, does nothing until the interval passes.
+ * @param worker
+ * @param die die the worker is optimizing, receives the migrant through Die::offer
+ */
+void MigrationHub::exchange(size_t worker, Die& die) {
+    if (_settings.interval <= 0 || _islands.size() < 2) return;
+    auto now = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<QMutex> lock(_mtx);
+        if (std::chrono::duration<double>(now - _islands[worker].lastExchange).count() < _settings.interval) return;
+        _islands[worker].lastExchange = now;
+    }
+
+    //copy outside the lock so other workers are not held up
+    auto posted = std::make_unique<PointSphere>(die.getBest());
+    double energy = posted->getTotalStress();
+
+    unique_ptr<PointSphere> migrant;
+    double migrantRate = 0;
+    {
+        std::lock_guard<QMutex> lock(_mtx);
+        Island& island = _islands[worker];
+        island.best = std::move(posted);
+        island.energy = energy;
+        island.rate = die.getMoveRate();
+
+        const Island& neighbour = _islands[neighbourOf(worker)];
+        if (!neighbour.best || neighbour.energy >= energy) return;
+        if (std::uniform_real_distribution<double>(0, 1)(_rng) >= _settings.selectionPressure) return;
+        migrant = std::make_unique<PointSphere>(*neighbour.best);
+        migrantRate = neighbour.rate;
+    }
+    die.offer(*migrant, migrantRate);
+}
+
+/**
+ * Pick the island a worker compares against.  Must be called with _mtx held.
+ * @param worker
+ * @return
+ */
+size_t MigrationHub::neighbourOf(size_t worker) {
+    if (_settings.topology == Topology::Ring) return (worker + 1) % _islands.size();
+    size_t other = std::uniform_int_distribution<size_t>(0, _islands.size() - 2)(_rng);
+    return (other >= worker) ? other + 1 : other;
+}
@@ -0,0 +1,48 @@
+#ifndef DICE_MIGRATIONHUB_H
+#define DICE_MIGRATIONHUB_H
+
+#include <vector>
+#include <memory>
+#include <random>
+#include <chrono>
+#include <limits>
+#include <QMutex>
+#include "Die.h"
+
+using namespace std;
+
+/**
+ * Island model exchange between workers.  Every interval each worker posts its best configuration and
+ * looks at one neighbour's; a better neighbour is copied in with probability selectionPressure.
+ */
+class MigrationHub {
+public:
+    enum class Topology { Ring, Random };
+
+    struct Settings {
+        double interval = 60;               //seconds between exchanges, 0 disables migration
+        Topology topology = Topology::Ring;
+        double selectionPressure = 0.5;    //chance a better neighbour replaces the worker's die
+    };
+
+    MigrationHub(size_t workerCount, const Settings& settings);
+    void exchange(size_t worker, Die& die);
+    void reset(size_t worker);
+
+private:
+    struct Island {
+        unique_ptr<PointSphere> best;
+        double energy = numeric_limits<double>::infinity();
+        double rate = 0;
+        std::chrono::steady_clock::time_point lastExchange;
+    };
+
+    QMutex _mtx;
+    Settings _settings;
+    vector<Island> _islands;
+    mt19937 _rng;
+
+    size_t neighbourOf(size_t worker);
+};
+
+#endif //DICE_MIGRATIONHUB_H
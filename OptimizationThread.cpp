@@ -1,35 +1,81 @@
 // OptimizationThread.cpp
 #include "OptimizationThread.h"
+#include "CpuPlacement.h"
+#include <iostream>
+#include <memory>
 
-OptimizationThread::OptimizationThread(size_t index, std::array<Die*, THREAD_COUNT>& dieArray, unsigned int sides,
-                                       std::atomic<bool>& running,
+OptimizationThread::OptimizationThread(size_t index, DieRegistry& dieRegistry, unsigned int sides,
+                                       RunControl& control, RestartScheduler& scheduler,
+                                       MigrationHub& migration, RunState* state, TrajectoryLog* log,
                                        QObject* parent)
-        : QThread(parent), _index(index), _dieArray(dieArray), _sides(sides), _running(running) {
-    _bestMutex = new QMutex();
+        : QThread(parent), _index(index), _dieRegistry(dieRegistry), _sides(sides), _control(control),
+          _scheduler(scheduler), _migration(migration), _state(state), _log(log) {
+}
+
+/**
+ * Die this thread had when the run state was saved, along with its restart statistics
+ * @return null if there is nothing to resume
+ */
+Die* OptimizationThread::resumeDie() {
+    if (_state == nullptr) return nullptr;
+    string saved = _state->takeRestored(_index);
+    if (saved.empty()) return nullptr;
+    try {
+        RunState::Reader reader(saved);
+        auto die = std::make_unique<Die>(_sides, reader);
+        _scheduler.readState(_index, reader);
+        return die.release();
+    } catch (const std::exception& e) {
+        cerr << "Optimizer " << _index << " could not resume: " << e.what() << "\n";
+        return nullptr;
+    }
+}
+
+/**
+ * Hand this thread's state to the run state
+ * @param die
+ */
+void OptimizationThread::provideState(const Die& die) {
+    RunState::Writer writer;
+    die.writeState(writer);
+    _scheduler.writeState(_index, writer);
+    _state->provide(_index, writer.bytes());
 }
 
 void OptimizationThread::run() {
-    const size_t bestThreadIndex = THREAD_COUNT - 1;
-    while (_running.load()) {
+    const size_t bestThreadIndex = _dieRegistry.bestSlot();
+    //pin before the first die is made so its points are allocated on this thread's node
+    CpuPlacement::instance().pinCurrentThread("Optimizer", _index);
+    while (!_control.isStopping()) {
         try {
-            Die* currentDie = new Die(_sides, false);
-
-            {
-                QMutexLocker locker(_bestMutex);
-                if (_dieArray[_index] != nullptr) delete _dieArray[_index];
-                _dieArray[_index] = currentDie;
+            Die* currentDie = resumeDie();
+            if (currentDie == nullptr) {
+                currentDie = new Die(_sides, false);
+                _scheduler.beginRun(_index);
             }
 
-            while (_running.load() && (currentDie->getSecondsSinceLastBest() < 120)) {
-                currentDie->optimize();
+            _dieRegistry.replace(_index, currentDie);
+            if (_log != nullptr) _log->restart(_index, *currentDie);
+
+            _migration.reset(_index);
+            while (_control.waitWhilePaused() && !_scheduler.shouldRestart(_index, *currentDie)) {
+                for (int i = 0; i < 64 && !_control.isStopping(); ++i) currentDie->optimize();
+                _migration.exchange(_index, *currentDie);
+                if (_log != nullptr) _log->sample(_index, *currentDie);
+                if (_state != nullptr && _state->wanted(_index)) provideState(*currentDie);
             }
+            currentDie->flushNotifications();
+
+            //leave the final state for the run state to write once every thread has stopped
+            if (_state != nullptr && _control.isStopping()) provideState(*currentDie);
 
             {
-                QMutexLocker locker(_bestMutex);
-                if (_dieArray[bestThreadIndex] != nullptr) {
-                    double currentStress = currentDie->getBest().getTotalStress();
-                    if (currentStress < _dieArray[bestThreadIndex]->getBest().getTotalStress()) {
-                        *(_dieArray[bestThreadIndex]) = *currentDie;
+                EpochGuard guard;
+                Die* bestDie = _dieRegistry.get(bestThreadIndex);
+                if (bestDie != nullptr) {
+                    double currentStress = currentDie->getBestStress();
+                    if (currentStress < bestDie->getBestStress()) {
+                        bestDie->offer(*currentDie);
                     }
                 }
             }
@@ -3,29 +3,37 @@
 #define OPTIMIZATIONTHREAD_H
 
 #include <QThread>
-#include <array>
-#include <QMutex>
 #include "Die.h"
+#include "DieRegistry.h"
+#include "RestartScheduler.h"
+#include "MigrationHub.h"
+#include "RunControl.h"
+#include "RunState.h"
+#include "TrajectoryLog.h"
 
 
-//thread count must be at least 2
-#define THREAD_COUNT 5
-
 class OptimizationThread : public QThread {
 Q_OBJECT
 public:
-    OptimizationThread(size_t index, std::array<Die*, THREAD_COUNT>& dieArray, unsigned int sides, std::atomic<bool>& running,
-                       QObject* parent = nullptr);
+    OptimizationThread(size_t index, DieRegistry& dieRegistry, unsigned int sides, RunControl& control,
+                       RestartScheduler& scheduler, MigrationHub& migration, RunState* state = nullptr,
+                       TrajectoryLog* log = nullptr, QObject* parent = nullptr);
 
 protected:
     void run() override;
 
 private:
     size_t _index;
-    std::array<Die*, THREAD_COUNT>& _dieArray;
+    DieRegistry& _dieRegistry;
     unsigned int _sides;
-    QMutex* _bestMutex;
-    std::atomic<bool>& _running;
+    RunControl& _control;
+    RestartScheduler& _scheduler;
+    MigrationHub& _migration;
+    RunState* _state;           //null when the run state is not kept
+    TrajectoryLog* _log;        //null when not logging
+
+    Die* resumeDie();
+    void provideState(const Die& die);
 };
 
 #endif // OPTIMIZATIONTHREAD_H
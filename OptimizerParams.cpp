@@ -0,0 +1,111 @@
+#include "OptimizerParams.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+
+namespace {
+    std::mutex presetMutex;
+    vector<OptimizerParams> presets;
+    bool presetsLoaded = false;
+    int reorderOverride = -1;
+}
+
+/**
+ * Returns the preset for a side count.  Uses the preset tuned for the largest side count not above sides,
+ * or the smallest preset if sides is below all of them.  Presets are loaded from PRESET_FILE on first use.
+ * @param sides
+ * @return
+ */
+OptimizerParams OptimizerParams::forSides(size_t sides) {
+    std::lock_guard<std::mutex> lock(presetMutex);
+    if (!presetsLoaded) {
+        presets = loadPresets();
+        presetsLoaded = true;
+    }
+
+    OptimizerParams result;
+    if (!presets.empty()) result = presets.front();
+    for (const auto& preset: presets) {
+        if (preset.sides > sides) break;
+        result = preset;
+    }
+    if (reorderOverride >= 0) result.reorderSweeps = static_cast<unsigned int>(reorderOverride);
+    return result;
+}
+
+/**
+ * Use the same reorder interval for every side count, whatever the presets say
+ * @param sweeps
+ */
+void OptimizerParams::overrideReorderSweeps(unsigned int sweeps) {
+    std::lock_guard<std::mutex> lock(presetMutex);
+    reorderOverride = static_cast<int>(sweeps);
+}
+
+/**
+ * Replace the presets used by forSides without touching disk
+ * @param newPresets
+ */
+void OptimizerParams::setPresets(const vector<OptimizerParams>& newPresets) {
+    std::lock_guard<std::mutex> lock(presetMutex);
+    presets = newPresets;
+    std::sort(presets.begin(), presets.end(),
+              [](const OptimizerParams& a, const OptimizerParams& b) { return a.sides < b.sides; });
+    presetsLoaded = true;
+}
+
+/**
+ * Load presets from a csv file.  Returns an empty list if the file does not exist.
+ * @param filename
+ * @return sorted by side count
+ */
+vector<OptimizerParams> OptimizerParams::loadPresets(const string& filename) {
+    vector<OptimizerParams> result;
+    ifstream inFile(filename);
+    if (!inFile.is_open()) return result;
+
+    string line;
+    getline(inFile, line);  //skip header
+    while (getline(inFile, line)) {
+        if (line.empty()) continue;
+        for (char& c: line) if (c == ',') c = ' ';
+        stringstream ss(line);
+        OptimizerParams preset;
+        if (!(ss >> preset.sides >> preset.randomPickOdds >> preset.neighbourWindow >> preset.startRate
+                 >> preset.reduceRate >> preset.restartTimeout)) {
+            cerr << "Skipping bad preset line in " << filename << ": " << line << endl;
+            continue;
+        }
+        if (!(ss >> preset.continuationSteps)) preset.continuationSteps = OptimizerParams().continuationSteps;
+        if (!(ss >> preset.reorderSweeps)) preset.reorderSweeps = OptimizerParams().reorderSweeps;
+        if (preset.randomPickOdds == 0) preset.randomPickOdds = 1;
+        result.push_back(preset);
+    }
+
+    std::sort(result.begin(), result.end(),
+              [](const OptimizerParams& a, const OptimizerParams& b) { return a.sides < b.sides; });
+    return result;
+}
+
+/**
+ * Write presets to a csv file
+ * @param presetList
+ * @param filename
+ */
+void OptimizerParams::savePresets(const vector<OptimizerParams>& presetList, const string& filename) {
+    ofstream outFile(filename);
+    if (!outFile.is_open()) {
+        cerr << "Unable to open file for writing: " << filename << endl;
+        return;
+    }
+    outFile << "sides,randomPickOdds,neighbourWindow,startRate,reduceRate,restartTimeout,continuationSteps,reorderSweeps" << endl;
+    outFile << setprecision(6);
+    for (const auto& preset: presetList) {
+        outFile << preset.sides << "," << preset.randomPickOdds << "," << preset.neighbourWindow << ","
+                << preset.startRate << "," << preset.reduceRate << "," << preset.restartTimeout << ","
+                << preset.continuationSteps << "," << preset.reorderSweeps << endl;
+    }
+}
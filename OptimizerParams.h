@@ -0,0 +1,32 @@
+#ifndef DICE_OPTIMIZERPARAMS_H
+#define DICE_OPTIMIZERPARAMS_H
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+//file the tuner writes and the optimizer reads presets from
+#define PRESET_FILE "presets.csv"
+
+/**
+ * Knobs that control how Die searches.  Defaults match the values that used to be hard coded.
+ */
+struct OptimizerParams {
+    size_t sides = 0;                   //side count this preset was tuned for (0 = built in default)
+    unsigned int randomPickOdds = 16;   //1 in randomPickOdds moves picks a point at random
+    double neighbourWindow = 1.0;       //neighbour pick window is neighbourWindow * sqrt(sides)
+    double startRate = 0.1;             //initial move rate is startRate / sides
+    long reduceRate = 30;               //seconds without a best before the move rate is halved
+    long restartTimeout = 120;          //seconds without a best before a worker restarts
+    unsigned int continuationSteps = 20;    //moves per point at each softer potential of a random start, 0 = off
+    unsigned int reorderSweeps = 0;     //moves per point between sorting points along a space filling curve, 0 = off
+
+    static OptimizerParams forSides(size_t sides);
+    static void setPresets(const vector<OptimizerParams>& presets);
+    static void overrideReorderSweeps(unsigned int sweeps);
+    static vector<OptimizerParams> loadPresets(const string& filename = PRESET_FILE);
+    static void savePresets(const vector<OptimizerParams>& presets, const string& filename = PRESET_FILE);
+};
+
+#endif //DICE_OPTIMIZERPARAMS_H
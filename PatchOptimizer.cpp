@@ -0,0 +1,259 @@
+#include "PatchOptimizer.h"
+#include "OptimizerParams.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+
+//points closer than this many typical spacings are treated exactly, everything further away as far field
+#define NEAR_SPACINGS 4
+
+//times each point is moved per round
+#define SWEEPS_PER_ROUND 4
+
+//first move size of a patch, in typical spacings
+#define START_STEP 0.05
+
+//move size is scaled by these after a kept and a rejected move
+#define ACCEPT_SCALE 1.2
+#define REJECT_SCALE 0.7
+
+/**
+ * Create a patch optimizer
+ * @param sides
+ * @param loadBest start from the saved best if there is one
+ * @param threadCount threads relaxing patches, including the one calling round
+ * @param patchCount number of patches relaxed in parallel each round
+ */
+PatchOptimizer::PatchOptimizer(size_t sides, bool loadBest, size_t threadCount, size_t patchCount)
+        : _sideCount(sides), _pointCount(sides / 2), _rng(std::random_device()()),
+          _pool(std::make_unique<ThreadPool>(std::max<size_t>(1, threadCount) - 1)), _best(sides),
+          _lastBestTime(std::chrono::steady_clock::now()) {
+    _rate = OptimizerParams::forSides(sides).startRate / sides;
+    if (loadBest) {
+        try {
+            _rate = _best.load();
+        } catch (...) {
+        }
+    }
+    for (size_t i = 0; i < _pointCount; ++i) _points.push_back(_best.getPoint(i * 2));
+    _stress = _bestStress = _best.getTotalStress();
+
+    //points spread evenly on a hexagonal grid are about sqrt(8 pi / (sqrt(3) sides)) apart
+    double spacingSquared = 8 * M_PI / (sqrt(3.0) * sides);
+    _nearDistanceSquared = NEAR_SPACINGS * NEAR_SPACINGS * spacingSquared;
+
+    //patch axes spread over one hemisphere on a Fibonacci spiral
+    patchCount = std::max<size_t>(1, std::min(patchCount, _pointCount));
+    const double goldenAngle = M_PI * (3 - sqrt(5.0));
+    for (size_t k = 0; k < patchCount; ++k) {
+        double z = 1 - (k + 0.5) / patchCount;
+        double r = sqrt(1 - z * z);
+        _centres.emplace_back(r * cos(k * goldenAngle), r * sin(k * goldenAngle), z);
+    }
+    _patches.resize(patchCount);
+    _steps.assign(patchCount, START_STEP * sqrt(spacingSquared));
+    _owner.resize(_pointCount);
+    _near.resize(_pointCount);
+    _farGradient.resize(_pointCount);
+}
+
+/**
+ * Run one round: freeze, build the near lists and far field, relax every patch in parallel then score the
+ * result exactly.  A round that made things worse is undone and its patches take smaller steps.
+ */
+void PatchOptimizer::round() {
+    const vector<Vec3> frozen = _points;
+    assignPatches();
+
+    ThreadPool& pool = *_pool;
+    pool.parallelFor(_patches.size(), [this, &frozen](size_t patch) {
+        for (size_t index: _patches[patch]) buildField(index, frozen);
+    });
+    pool.parallelFor(_patches.size(), [this, &frozen](size_t patch) {
+        relaxPatch(patch, frozen);
+    });
+    _rounds.fetch_add(1);
+
+    double stress = score();
+    if (!(stress < _stress)) {
+        _points = frozen;
+        for (double& step: _steps) step *= REJECT_SCALE;
+        return;
+    }
+    _stress = stress;
+}
+
+/**
+ * Turn the patch axes to a random orientation and give each point to the patch whose axis it is closest to
+ */
+void PatchOptimizer::assignPatches() {
+    std::normal_distribution<double> normal(0.0, 1.0);
+    Vec3 u(normal(_rng), normal(_rng), normal(_rng));
+    u.normalize();
+    Vec3 v = u.cross(Vec3(normal(_rng), normal(_rng), normal(_rng)));
+    v.normalize();
+    Vec3 w = u.cross(v);
+    for (auto& centre: _centres) {
+        centre = u * centre.x + v * centre.y + w * centre.z;
+        centre.normalize();
+    }
+
+    for (auto& patch: _patches) patch.clear();
+    for (size_t i = 0; i < _pointCount; ++i) {
+        size_t owner = 0;
+        double closest = -1;
+        for (size_t k = 0; k < _centres.size(); ++k) {
+            double alignment = fabs(_points[i].dot(_centres[k]));
+            if (alignment <= closest) continue;
+            closest = alignment;
+            owner = k;
+        }
+        _owner[i] = owner;
+        _patches[owner].push_back(i);
+    }
+}
+
+/**
+ * Find the near points of a point and sum the energy gradient from all the others
+ * @param index
+ * @param frozen positions at the start of the round
+ */
+void PatchOptimizer::buildField(size_t index, const vector<Vec3>& frozen) {
+    const Vec3& point = frozen[index];
+    vector<size_t>& near = _near[index];
+    Vec3 gradient(0, 0, 0);
+    near.clear();
+    for (size_t j = 0; j < _pointCount; ++j) {
+        if (j == index) continue;
+        Vec3 toPoint = point - frozen[j];
+        Vec3 toMirror = point + frozen[j];
+        double pointSquared = toPoint.lengthSquared();
+        double mirrorSquared = toMirror.lengthSquared();
+        if (std::min(pointSquared, mirrorSquared) < _nearDistanceSquared) {
+            near.push_back(j);
+            continue;
+        }
+
+        //each stored pair stands for two pairs of sides, so d/dp of 2 (1/|p-q|^2 + 1/|p+q|^2)
+        gradient += toPoint * (-4 / (pointSquared * pointSquared));
+        gradient += toMirror * (-4 / (mirrorSquared * mirrorSquared));
+    }
+    _farGradient[index] = gradient;
+}
+
+/**
+ * Relax the points of one patch.  Only this patch's points are written, other patches are read from the
+ * frozen copy so patches can run at the same time.
+ * @param patch
+ * @param frozen positions at the start of the round
+ */
+void PatchOptimizer::relaxPatch(size_t patch, const vector<Vec3>& frozen) {
+    auto position = [this, patch, &frozen](size_t j) -> const Vec3& {
+        return (_owner[j] == patch) ? _points[j] : frozen[j];
+    };
+
+    //energy of a point from its near list, and its gradient if asked for
+    auto nearEnergy = [this, &position](size_t index, const Vec3& point, Vec3* gradient) {
+        double energy = 0;
+        for (size_t j: _near[index]) {
+            const Vec3& other = position(j);
+            Vec3 toPoint = point - other;
+            Vec3 toMirror = point + other;
+            double pointSquared = toPoint.lengthSquared();
+            double mirrorSquared = toMirror.lengthSquared();
+            if (pointSquared == 0 || mirrorSquared == 0) return numeric_limits<double>::infinity();
+            energy += 2 * (1 / pointSquared + 1 / mirrorSquared);
+            if (gradient == nullptr) continue;
+            *gradient += toPoint * (-4 / (pointSquared * pointSquared));
+            *gradient += toMirror * (-4 / (mirrorSquared * mirrorSquared));
+        }
+        return energy;
+    };
+
+    double& step = _steps[patch];
+    const double minStep = 1e-12;
+    for (int sweep = 0; sweep < SWEEPS_PER_ROUND; ++sweep) {
+        for (size_t index: _patches[patch]) {
+            Vec3 point = _points[index];
+            Vec3 gradient = _farGradient[index];
+            double before = nearEnergy(index, point, &gradient);
+
+            //move downhill along the sphere
+            Vec3 tangent = gradient - point * point.dot(gradient);
+            double length = tangent.length();
+            if (length == 0) continue;
+            Vec3 moved = point - tangent * (step / length);
+            moved.normalize();
+
+            //far field is linear in the move for the rest of the round
+            double after = nearEnergy(index, moved, nullptr);
+            double delta = after - before + _farGradient[index].dot(moved - point);
+            if (delta < 0) {
+                _points[index] = moved;
+                step *= ACCEPT_SCALE;
+            } else {
+                step = std::max(step * REJECT_SCALE, minStep);
+            }
+        }
+    }
+}
+
+/**
+ * Score the current points exactly and keep them if they are the best yet
+ * @return energy of the current points
+ */
+double PatchOptimizer::score() {
+    PointSphere sphere(_sideCount, _points);
+    sphere.setPool(_pool.get());
+    double stress = sphere.getTotalStress();
+
+    std::lock_guard<QMutex> lock(_bestMutex);
+    if (stress < _bestStress) {
+        _best = sphere;
+        _bestStress = stress;
+        _lastBestTime = std::chrono::steady_clock::now();
+        _version.fetch_add(1);
+    }
+    return stress;
+}
+
+double PatchOptimizer::getBestStress() const {
+    std::lock_guard<QMutex> lock(_bestMutex);
+    return _bestStress;
+}
+
+PointSphere PatchOptimizer::getBest() const {
+    std::lock_guard<QMutex> lock(_bestMutex);
+    return _best;
+}
+
+/**
+ * Number of times the best configuration has changed
+ * @return
+ */
+uint64_t PatchOptimizer::getVersion() const {
+    return _version.load();
+}
+
+/**
+ * Rounds run so far
+ * @return
+ */
+uint64_t PatchOptimizer::getRounds() const {
+    return _rounds.load();
+}
+
+long PatchOptimizer::getSecondsSinceLastBest() const {
+    std::lock_guard<QMutex> lock(_bestMutex);
+    auto now = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::seconds>(now - _lastBestTime).count();
+}
+
+/**
+ * Write the best configuration to best/ if it beats what is there
+ */
+void PatchOptimizer::save() {
+    PointSphere best = getBest();
+    best.save(_rate);
+}
@@ -0,0 +1,65 @@
+#ifndef DICE_PATCHOPTIMIZER_H
+#define DICE_PATCHOPTIMIZER_H
+
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <memory>
+#include <QMutex>
+#include "PointSphere.h"
+#include "ThreadPool.h"
+#include "Vec3.h"
+
+using namespace std;
+
+/**
+ * Optimizes a huge die by splitting the sphere into patches that are relaxed in parallel.  Each round the
+ * points are frozen, every point gets a list of near points and the pull of everything further away is
+ * summed once.  Then each patch is relaxed on its own, seeing its own points live, near points of other
+ * patches (the halo) as they were at the start of the round, and the far field as a fixed linear term.  The
+ * patch centres are rotated every round so points on a boundary end up inside a patch the next time.
+ */
+class PatchOptimizer {
+    size_t _sideCount;
+    size_t _pointCount;
+    vector<Vec3> _points;               //stored points, each stands for itself and its mirror image
+    double _stress;                     //exact energy of _points
+    double _nearDistanceSquared;
+    mt19937 _rng;
+    unique_ptr<ThreadPool> _pool;       //own pool so the run uses the threads it was given, not every core
+
+    vector<Vec3> _centres;              //axis of each patch, a patch covers both ends of its axis
+    vector<vector<size_t>> _patches;
+    vector<size_t> _owner;              //patch of each point
+    vector<double> _steps;              //move size of each patch, adapted as moves are kept or rejected
+    vector<vector<size_t>> _near;
+    vector<Vec3> _farGradient;
+
+    mutable QMutex _bestMutex;
+    PointSphere _best;
+    double _bestStress;
+    double _rate;                       //move rate stored with saves so a normal run can resume from them
+    std::chrono::steady_clock::time_point _lastBestTime;
+    std::atomic<uint64_t> _version{0};
+    std::atomic<uint64_t> _rounds{0};
+
+    void assignPatches();
+    void buildField(size_t index, const vector<Vec3>& frozen);
+    void relaxPatch(size_t patch, const vector<Vec3>& frozen);
+    double score();
+
+public:
+    PatchOptimizer(size_t sides, bool loadBest, size_t threadCount, size_t patchCount);
+
+    void round();
+
+    double getBestStress() const;
+    PointSphere getBest() const;
+    uint64_t getVersion() const;
+    uint64_t getRounds() const;
+    long getSecondsSinceLastBest() const;
+    void save();
+};
+
+#endif //DICE_PATCHOPTIMIZER_H
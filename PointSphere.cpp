@@ -7,9 +7,147 @@
 #include <iomanip>
 #include <iostream>
 #include <filesystem>
+#include <algorithm>
 #include "PointSphere.h"
+#include <QFile>
+#include "ThreadPool.h"
+#include "Checkpoint.h"
+#include "BestArchive.h"
+#include "AtomicFile.h"
+#include "SaveWriter.h"
+#include <cstdint>
 #include <limits>
 #include <mutex>
+#include <atomic>
+#include <cstring>
+#include <map>
+
+//side count from which pair loops are summed in blocks, and split across the pool if one is set
+#define PARALLEL_SIDES 512
+
+//rows of the pair loop handled per block.  Fixed so the reduction order never depends on thread count
+#define PAIR_BLOCK_ROWS 16
+
+//bits per axis of the Hilbert curve on each cube face
+#define CURVE_BITS 16
+
+//a csv only replaces an exact source if it is better by more than this, relative.  Its header and points are
+//both rounded, so the same result scored from the csv points differs in the last digits either way
+#define CSV_TOLERANCE 1e-12
+
+namespace {
+    std::atomic<bool> csvExport{false};
+
+    /**
+     * Path of a side count's best result
+     * @param sideCount
+     * @param extension
+     * @return
+     */
+    string bestFile(size_t sideCount, const string& extension) {
+        return "best/" + to_string(sideCount) + extension;
+    }
+
+    /**
+     * Stress recorded on the first line of a best csv
+     * @param in
+     * @return infinity if there is none
+     */
+    double csvStress(istream& in) {
+        string line, stressLabel;
+        double stress;
+        if (!getline(in, line)) return numeric_limits<double>::infinity();
+        stringstream ss(line);
+        if (!(ss >> stressLabel >> stress)) return numeric_limits<double>::infinity();
+        return stress;
+    }
+
+    /**
+     * Stress recorded in a side count's best csv in best/
+     * @param sideCount
+     * @return infinity if there is none
+     */
+    double savedCsvStress(size_t sideCount) {
+        ifstream inFile(bestFile(sideCount, ".csv"));
+        return csvStress(inFile);
+    }
+
+    /**
+     * Best csv of a side count compiled into the program.  Resources are decompressed when opened, so only the
+     * side count asked for is ever decoded.
+     * @param sideCount
+     * @return empty if none is embedded
+     */
+    string embeddedCsv(size_t sideCount) {
+        QFile file(QString::fromStdString(":/" + bestFile(sideCount, ".csv")));
+        if (!file.open(QIODevice::ReadOnly)) return "";
+        return file.readAll().toStdString();
+    }
+
+    /**
+     * Best checkpoint of a side count compiled into the program, so results saved without -csv can be built in
+     * @param sideCount
+     * @return empty if none is embedded or it does not check out
+     */
+    string embeddedCheckpoint(size_t sideCount) {
+        QFile file(QString::fromStdString(":/" + bestFile(sideCount, CHECKPOINT_EXTENSION)));
+        if (!file.open(QIODevice::ReadOnly)) return "";
+        string bytes = file.readAll().toStdString();
+        if (!Checkpoint::validate(reinterpret_cast<const unsigned char*>(bytes.data()), bytes.size())) return "";
+        Checkpoint::Header header;
+        memcpy(&header, bytes.data(), sizeof(header));
+        if (header.sideCount != sideCount) return "";
+        return bytes;
+    }
+
+    /**
+     * Lowest stress of the results compiled into the program.  Resources never change, so each side count is
+     * only decompressed the first time it is asked for.
+     * @param sideCount
+     * @return infinity if there is none
+     */
+    double embeddedStress(size_t sideCount) {
+        static QMutex cacheMutex;
+        static map<size_t, double> cache;
+        std::lock_guard<QMutex> lock(cacheMutex);
+        auto found = cache.find(sideCount);
+        if (found != cache.end()) return found->second;
+
+        istringstream csv(embeddedCsv(sideCount));
+        double stress = csvStress(csv);
+        string checkpoint = embeddedCheckpoint(sideCount);
+        if (!checkpoint.empty()) {
+            Checkpoint::Header header;
+            memcpy(&header, checkpoint.data(), sizeof(header));
+            stress = std::min(stress, header.stress);
+        }
+        cache[sideCount] = stress;
+        return stress;
+    }
+
+    /**
+     * Distance along a Hilbert curve filling a 2^CURVE_BITS square
+     * @param x
+     * @param y
+     * @return
+     */
+    uint64_t hilbertIndex(uint32_t x, uint32_t y) {
+        uint64_t d = 0;
+        for (uint32_t s = 1u << (CURVE_BITS - 1); s > 0; s /= 2) {
+            uint32_t rx = (x & s) > 0;
+            uint32_t ry = (y & s) > 0;
+            d += static_cast<uint64_t>(s) * s * ((3 * rx) ^ ry);
+            if (ry == 0) {
+                if (rx == 1) {
+                    x = s - 1 - x;
+                    y = s - 1 - y;
+                }
+                std::swap(x, y);
+            }
+        }
+        return d;
+    }
+}
 
 /**
  * Generates a random point sphere of a specific number of sides
@@ -30,6 +168,16 @@ PointSphere::PointSphere(size_t sideCount) : _sideCount(sideCount) {
     }
 }
 
+/**
+ * Sphere of given stored points, used as they are so their energy is exactly that of the points given
+ * @param sideCount
+ * @param points one per mirror pair
+ */
+PointSphere::PointSphere(size_t sideCount, const vector<Vec3>& points) : _sideCount(sideCount), _points(points) {
+    if (sideCount % 2 == 1) throw out_of_range("must be even number");
+    if (points.size() != sideCount / 2) throw out_of_range("need one point per mirror pair");
+}
+
 /**
  * Allow constructing of a PointSphere from another
  * @param other
@@ -42,6 +190,9 @@ PointSphere::PointSphere(const PointSphere& other) {
     _lowestStressIndex = other._lowestStressIndex;
     _highestStressIndex = other._highestStressIndex;
     _totalStress = other._totalStress;
+    _exponent = other._exponent;
+    _externalIndex = other._externalIndex;
+    _flipped = other._flipped;
 }
 
 /**
@@ -58,29 +209,108 @@ PointSphere& PointSphere::operator=(const PointSphere& other) {
         _lowestStressIndex = other._lowestStressIndex;
         _highestStressIndex = other._highestStressIndex;
         _totalStress = other._totalStress;
+        _exponent = other._exponent;
+        _externalIndex = other._externalIndex;
+        _flipped = other._flipped;
     }
     return *this;
 }
 
 /**
- * Load best known result
+ * Copy only some points from another sphere with the same side count and point order.  Lets a copy be kept
+ * in sync without copying every point.
+ * @param other
+ * @param pointIndices indexes into the stored half of the points (sideIndex / 2)
  */
-double PointSphere::load() {
-    double rate;
-
-    //compute file name
-    const string filename = "best/" + to_string(_sideCount) + ".csv";
-
-    //get side count from name
-    std::string baseName = filename.substr(5, filename.length() - 9);
-    _sideCount = std::stoi(baseName);
+void PointSphere::copyPoints(const PointSphere& other, const vector<size_t>& pointIndices) {
+    if (this == &other) return;
+    std::lock_guard<QMutex> lockThis(_mtx);
+    std::lock_guard<QMutex> lockOther(other._mtx);
+    for (size_t index: pointIndices) {
+        _points[index] = other._points[index];
+    }
+    _lowestStressIndex = other._lowestStressIndex;
+    _highestStressIndex = other._highestStressIndex;
+    _totalStress = other._totalStress;
+    _exponent = other._exponent;
+}
 
+/**
+ * Load best known result.  Takes the lowest stress of the binary checkpoint, the packed archive, the csv and
+ * the result compiled into the program, so a better result copied in by hand is not hidden by an older exact
+ * one, and a release runs without any best/ directory.
+ * @return move rate saved with it
+ */
+double PointSphere::load() {
     //make sure read and writes not at the same time
     std::lock_guard<QMutex> lock(_mtx);
 
-    //check file exists
-    ifstream inFile(filename);
-    if (!inFile.is_open()) throw exception();
+    double diskCsvStress = savedCsvStress(_sideCount);
+    string embedded = embeddedCsv(_sideCount);
+    istringstream embeddedFile(embedded);
+    double embeddedStress = csvStress(embeddedFile);
+    double csvStress = std::min(diskCsvStress, embeddedStress);
+    double exactLimit = csvStress * (1 + CSV_TOLERANCE);
+    Checkpoint checkpoint(bestFile(_sideCount, CHECKPOINT_EXTENSION));
+    bool useCheckpoint = checkpoint.isValid() && checkpoint.header().sideCount == _sideCount
+                         && checkpoint.header().stress <= exactLimit;
+    BestArchive archive;
+    const BestArchive::Entry* packed = archive.find(_sideCount);
+    if (packed != nullptr && (packed->stress > exactLimit || !archive.verify(*packed))) packed = nullptr;
+    if (packed != nullptr && useCheckpoint && checkpoint.header().stress <= packed->stress) packed = nullptr;
+
+    //a checkpoint compiled into the program only wins if it beats everything on disk
+    string builtIn = embeddedCheckpoint(_sideCount);
+    Checkpoint::Header builtInHeader{};
+    if (!builtIn.empty()) memcpy(&builtInHeader, builtIn.data(), sizeof(builtInHeader));
+    if (!builtIn.empty() && builtInHeader.stress <= exactLimit
+        && (!useCheckpoint || builtInHeader.stress < checkpoint.header().stress)
+        && (packed == nullptr || builtInHeader.stress < packed->stress)) {
+        _points.clear();
+        for (size_t i = 0; i < _sideCount / 2; ++i) {
+            double xyz[3];
+            memcpy(xyz, builtIn.data() + sizeof(Checkpoint::Header) + i * sizeof(xyz), sizeof(xyz));
+            _points.emplace_back(xyz[0], xyz[1], xyz[2]);
+        }
+        _externalIndex.clear();
+        _flipped.clear();
+        _lowestStressIndex = numeric_limits<size_t>::max();
+        _highestStressIndex = numeric_limits<size_t>::max();
+        _totalStress = (_exponent == 2) ? builtInHeader.stress : numeric_limits<double>::infinity();
+        _loadedFrom = "built-in checkpoint";
+        return builtInHeader.rate;
+    }
+
+    //exact sources, the points are bit for bit what was scored so the saved stress is reused
+    if (useCheckpoint || packed != nullptr) {
+        _points.clear();
+        for (size_t i = 0; i < _sideCount / 2; ++i) {
+            _points.push_back(packed ? archive.point(*packed, i) : checkpoint.point(i));
+        }
+        _externalIndex.clear();
+        _flipped.clear();
+        _lowestStressIndex = numeric_limits<size_t>::max();
+        _highestStressIndex = numeric_limits<size_t>::max();
+        double stress = packed ? packed->stress : checkpoint.header().stress;
+        _totalStress = (_exponent == 2) ? stress : numeric_limits<double>::infinity();
+        _loadedFrom = packed ? ARCHIVE_FILE : bestFile(_sideCount, CHECKPOINT_EXTENSION);
+        return packed ? packed->rate : checkpoint.header().rate;
+    }
+
+    double rate;
+    const string filename = bestFile(_sideCount, ".csv");
+
+    //the file in best/ wins unless the embedded one is better
+    ifstream diskFile;
+    bool useEmbedded = !embedded.empty() && embeddedStress < diskCsvStress;
+    if (!useEmbedded) {
+        diskFile.open(filename);
+        if (!diskFile.is_open()) throw exception();
+    }
+    embeddedFile.clear();
+    embeddedFile.seekg(0);
+    istream& inFile = useEmbedded ? static_cast<istream&>(embeddedFile) : diskFile;
+    _loadedFrom = useEmbedded ? "built-in csv" : filename;
 
     //skip over stress value
     string line;
@@ -99,8 +329,10 @@ double PointSphere::load() {
     //skip blank line
     getline(inFile, line);
 
-    //get points
+    //get points, file order is the stored order until permuted
     _points.clear();  // Clear any existing data in _points
+    _externalIndex.clear();
+    _flipped.clear();
     while (getline(inFile, line)) {
         if (_points.size() == _sideCount / 2) break;
         stringstream ss(line);
@@ -128,63 +360,217 @@ double PointSphere::load() {
         _points.push_back(point);
     }
 
-    inFile.close();
+    _lowestStressIndex = numeric_limits<size_t>::max();
+    _highestStressIndex = numeric_limits<size_t>::max();
+    _totalStress = numeric_limits<double>::infinity();
     return rate;
 }
 
 /**
- * Save the best result
+ * Where the last load took its points from, so tools can check which source won
+ * @return file name, or "built-in ..." for a result compiled into the program
+ */
+const string& PointSphere::loadedFrom() const {
+    return _loadedFrom;
+}
+
+/**
+ * Queue the points to be written to best/ if they beat the saved result.  Returns without waiting for the disk.
+ * @param rate move rate saved with the points
  */
 void PointSphere::save(double rate) {
-    //compute file name
-    const string filename = "best/" + to_string(_sideCount) + ".csv";
+    SaveWriter::Snapshot snapshot;
+    {
+        //make sure read and writes not at the same time
+        std::lock_guard<QMutex> lock(_mtx);
 
-    //create directory if it doesn't exist
-    std::filesystem::create_directories("best");
+        //check better than saved value
+        snapshot.stress = getTotalStress(false);
+        if (!SaveWriter::instance().isImprovement(_sideCount, snapshot.stress)) return;
+        snapshot.points = externalPoints();
+    }
+    snapshot.sideCount = _sideCount;
+    snapshot.rate = rate;
+    snapshot.csv = csvExport.load();
+    SaveWriter::instance().submit(std::move(snapshot));
+}
 
-    //make sure read and writes not at the same time
+/**
+ * Write a best result, replacing the old files atomically
+ * @param sideCount
+ * @param points stored points in file order
+ * @param stress
+ * @param rate
+ * @param csv also write the csv file
+ * @return false if a file could not be written
+ */
+bool PointSphere::writeBest(size_t sideCount, const vector<Vec3>& points, double stress, double rate, bool csv) {
+    if (!Checkpoint::write(bestFile(sideCount, CHECKPOINT_EXTENSION), sideCount, stress, rate, points)) return false;
+    if (!csv) return true;
+
+    //set output type
+    ostringstream out;
+    out << fixed << setprecision(15);
+
+    //write stress value
+    out << "Stress: " << stress << endl;
+    out << "Rate: " << rate << endl << endl;
+
+    //write points in file order so the side numbering of a saved die never changes
+    for (const auto& point: points) {
+        out << point.x << "," << point.y << "," << point.z << endl;
+    }
+    return AtomicFile::write(bestFile(sideCount, ".csv"), out.str());
+}
+
+/**
+ * Also write best/<sides>.csv whenever a checkpoint is saved
+ * @param enabled
+ */
+void PointSphere::setCsvExport(bool enabled) {
+    csvExport.store(enabled);
+}
+
+/**
+ * Stress of the best result known for a side count, the lowest of the checkpoint, archive, csv and the
+ * result compiled into the program
+ * @param sideCount
+ * @return infinity if there is none
+ */
+double PointSphere::savedStress(size_t sideCount) {
+    double stress = std::min(savedCsvStress(sideCount), embeddedStress(sideCount));
+    Checkpoint checkpoint(bestFile(sideCount, CHECKPOINT_EXTENSION));
+    if (checkpoint.isValid()) stress = std::min(stress, checkpoint.header().stress);
+    BestArchive archive;
+    if (const BestArchive::Entry* packed = archive.find(sideCount)) stress = std::min(stress, packed->stress);
+    return stress;
+}
+
+/**
+ * Store everything needed to rebuild this sphere exactly, including its point order and cached energy
+ * @param state
+ */
+void PointSphere::writeState(RunState::Writer& state) const {
     std::lock_guard<QMutex> lock(_mtx);
+    state.put<uint64_t>(_sideCount);
+    state.putPoints(_points);
+    state.putIndices(_externalIndex);
+    state.putFlags(_flipped);
+    state.put(_exponent);
+    state.put(_totalStress);
+}
 
-    //check better than saved vale
-    double bestStress = getTotalStress(false);
-    ifstream inFile(filename);
-    if (inFile.is_open()) {
-        string line;
-        // Read the first line which contains the saved stress value
-        if (getline(inFile, line)) {
-            stringstream ss(line);
-            string stressLabel;
-            double savedStress;
-
-            // Extract the stress value from the line, assuming it's after the "Stress: " label
-            if (ss >> stressLabel >> savedStress) {
-                // If the current best stress is greater than or equal to the saved value, return
-                if (bestStress >= savedStress) {
-                    inFile.close();
-                    return;
-                }
-            }
-        }
-        inFile.close();
+/**
+ * Rebuild a sphere stored with writeState
+ * @param state
+ */
+void PointSphere::readState(RunState::Reader& state) {
+    std::lock_guard<QMutex> lock(_mtx);
+    if (state.get<uint64_t>() != _sideCount) throw runtime_error("run state is for another side count");
+    vector<Vec3> points = state.getPoints();
+    vector<size_t> externalIndex = state.getIndices();
+    vector<bool> flipped = state.getFlags();
+    if (points.size() != _sideCount / 2 || externalIndex.size() != flipped.size() ||
+        (!externalIndex.empty() && externalIndex.size() != points.size())) {
+        throw runtime_error("run state is corrupt");
     }
+    _points = std::move(points);
+    _externalIndex = std::move(externalIndex);
+    _flipped = std::move(flipped);
+    _exponent = state.get<double>();
+    _totalStress = state.get<double>();
+    _lowestStressIndex = numeric_limits<size_t>::max();
+    _highestStressIndex = numeric_limits<size_t>::max();
+}
 
-    //set output type
-    ofstream outFile(filename);
-    outFile << fixed << setprecision(15);
+/**
+ * Stored points in the order and orientation they were loaded or created in
+ * @return
+ */
+vector<Vec3> PointSphere::externalPoints() const {
+    if (_externalIndex.empty()) return _points;
+    vector<Vec3> result(_points.size());
+    for (size_t i = 0; i < _points.size(); ++i) {
+        result[_externalIndex[i]] = _flipped[i] ? _points[i] * -1 : _points[i];
+    }
+    return result;
+}
 
-    //write stress value
-    outFile << "Stress: " << bestStress << endl;
-    outFile << "Rate: " << rate << endl << endl;
+/**
+ * Side index a side had in the file (or when created), which stays the same however the points are reordered
+ * @param sideIndex
+ * @return
+ */
+size_t PointSphere::externalSide(size_t sideIndex) const {
+    if (_externalIndex.empty()) return sideIndex;
+    size_t index = sideIndex / 2;
+    return _externalIndex[index] * 2 + ((sideIndex % 2 == 1) != _flipped[index]);
+}
 
-    //write points
-    if (outFile.is_open()) {
-        for (const auto& point: _points) {
-            outFile << point.x << "," << point.y << "," << point.z << endl;
-        }
-        outFile.close();
-    } else {
-        cerr << "Unable to open file for writing: " << filename << endl;
+/**
+ * Order that puts the stored points along a Hilbert curve on the faces of a cube, so points near each other
+ * on the sphere sit near each other in memory.  Each point is first swapped for its mirror image if needed so
+ * all of them lie on the +x, +y and +z faces, keeping mirror pairs from splitting neighbourhoods.
+ * @param flip set to whether each stored point should be mirrored
+ * @return current index of the point that should go in each position
+ */
+vector<size_t> PointSphere::curveOrder(vector<bool>& flip) const {
+    std::lock_guard<QMutex> lock(_mtx);
+    const double scale = ((1u << CURVE_BITS) - 1) / 2.0;
+    vector<pair<uint64_t, size_t>> keys;
+    flip.assign(_points.size(), false);
+    for (size_t i = 0; i < _points.size(); ++i) {
+        const Vec3& point = _points[i];
+        double axis[3] = {point.x, point.y, point.z};
+        int face = 0;
+        for (int a = 1; a < 3; ++a) if (fabs(axis[a]) > fabs(axis[face])) face = a;
+        flip[i] = axis[face] < 0;
+
+        //project onto the face, both coordinates end up in [-1, 1]
+        double sign = flip[i] ? -1 : 1;
+        double major = fabs(axis[face]);
+        double u = sign * axis[(face + 1) % 3] / major;
+        double v = sign * axis[(face + 2) % 3] / major;
+        auto x = static_cast<uint32_t>((u + 1) * scale);
+        auto y = static_cast<uint32_t>((v + 1) * scale);
+        keys.emplace_back((static_cast<uint64_t>(face) << (2 * CURVE_BITS)) | hilbertIndex(x, y), i);
+    }
+    std::sort(keys.begin(), keys.end());
+
+    vector<size_t> order;
+    for (const auto& key: keys) order.push_back(key.second);
+    return order;
+}
+
+/**
+ * Rearrange the stored points.  The file order is remembered so saves and external side numbers are not
+ * affected.  Energy is unchanged so the cached total is kept.
+ * @param order current index of the point that should go in each position, from curveOrder
+ * @param flip whether each stored point (by current index) is replaced by its mirror image
+ */
+void PointSphere::permute(const vector<size_t>& order, const vector<bool>& flip) {
+    std::lock_guard<QMutex> lock(_mtx);
+    if (_externalIndex.empty()) {
+        for (size_t i = 0; i < _points.size(); ++i) _externalIndex.push_back(i);
+        _flipped.assign(_points.size(), false);
     }
+
+    vector<Vec3> points(_points.size());
+    vector<size_t> externalIndex(_points.size());
+    vector<bool> flipped(_points.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        size_t from = order[i];
+        points[i] = flip[from] ? _points[from] * -1 : _points[from];
+        externalIndex[i] = _externalIndex[from];
+        flipped[i] = _flipped[from] != flip[from];
+    }
+    _points = std::move(points);
+    _externalIndex = std::move(externalIndex);
+    _flipped = std::move(flipped);
+
+    //side indexes moved
+    _lowestStressIndex = numeric_limits<size_t>::max();
+    _highestStressIndex = numeric_limits<size_t>::max();
 }
 
 /**
@@ -219,8 +605,14 @@ Vec3 PointSphere::getStress(size_t sideIndex, bool lockWhileExecuting) const {
         Vec3 direction = referencePoint - point;
         double distSquared = direction.lengthSquared();
         if (distSquared == 0.0) continue;
-        Vec3 directionNormalized = direction / sqrt(distSquared);
-        totalStress += directionNormalized * (1.0 / distSquared);
+        double dist = sqrt(distSquared);
+        Vec3 directionNormalized = direction / dist;
+        if (_exponent == 2) {
+            totalStress += directionNormalized * (1.0 / distSquared);
+        } else {
+            //softer potentials used while annealing push as 1/r^s like the scoring one, log potential like 1/r
+            totalStress += directionNormalized * ((_exponent == 0) ? 1.0 / dist : pow(dist, -_exponent));
+        }
     }
 
     return totalStress;
@@ -238,20 +630,57 @@ double PointSphere::getTotalStress(bool lockWhileExecuting) {
     if (_totalStress != numeric_limits<double>::infinity()) return _totalStress;
 
     //calculate total stress
-    _totalStress = 0.0;
-    for (size_t i = 0; i < _sideCount; ++i) {
+    double total = 0.0;
+    if (_sideCount < PARALLEL_SIDES) {
+        total = pairStress(0, _sideCount);
+    } else {
+        //sum each block of rows on its own then add the blocks up in order, the same with or without a pool
+        size_t blocks = (_sideCount + PAIR_BLOCK_ROWS - 1) / PAIR_BLOCK_ROWS;
+        vector<double> partial(blocks);
+        auto sumBlock = [this, &partial](size_t block) {
+            size_t first = block * PAIR_BLOCK_ROWS;
+            partial[block] = pairStress(first, std::min(first + PAIR_BLOCK_ROWS, _sideCount));
+        };
+        if (_pool != nullptr) {
+            _pool->parallelFor(blocks, sumBlock);
+        } else {
+            for (size_t block = 0; block < blocks; ++block) sumBlock(block);
+        }
+        for (double value: partial) total += value;
+    }
+
+    //two points on top of each other is infinite stress, don't cache it
+    if (std::isinf(total)) return total;
+    _totalStress = total;
+    return _totalStress;
+}
+
+/**
+ * Stress from the pairs (i, j) with firstRow <= i < lastRow and j > i
+ * @param firstRow
+ * @param lastRow
+ * @return
+ */
+double PointSphere::pairStress(size_t firstRow, size_t lastRow) const {
+    double total = 0.0;
+    for (size_t i = firstRow; i < lastRow; ++i) {
         Vec3 sideI = getPoint(i);
 
         // Consider the repulsion between point i and all other points
         for (size_t j = i + 1; j < _sideCount; ++j) {
-            if (i == j) continue;
             Vec3 sideJ = getPoint(j);
             double distSquared = sideI.distanceSquared(sideJ);
             if (distSquared == 0) return std::numeric_limits<double>::infinity();
-            _totalStress += 1.0 / distSquared;
+            if (_exponent == 2) {
+                total += 1.0 / distSquared;
+            } else if (_exponent == 0) {
+                total -= 0.5 * log(distSquared);
+            } else {
+                total += pow(distSquared, -_exponent / 2);
+            }
         }
     }
-    return _totalStress;
+    return total;
 }
 
 /**
@@ -282,17 +711,47 @@ void PointSphere::movePoint(size_t sideIndex, const Vec3& value) {
     _totalStress = numeric_limits<double>::infinity();
 }
 
+/**
+ * Change the Riesz exponent of the potential (0 for logarithmic).  2 is the exponent the dice are scored with.
+ * @param exponent
+ */
+void PointSphere::setExponent(double exponent) {
+    std::lock_guard<QMutex> lock(_mtx);
+    _exponent = exponent;
+
+    //clear caches
+    _lowestStressIndex = numeric_limits<size_t>::max();
+    _highestStressIndex = numeric_limits<size_t>::max();
+    _totalStress = numeric_limits<double>::infinity();
+}
+
+/**
+ * Split the pair sums of large spheres over a pool.  Only worth it for a caller that has cores to itself, not
+ * for one of several workers already keeping every core busy.
+ * @param pool nullptr to sum on the calling thread
+ */
+void PointSphere::setPool(ThreadPool* pool) {
+    _pool = pool;
+}
+
+/**
+ * Returns the Riesz exponent of the potential
+ * @return
+ */
+double PointSphere::getExponent() const {
+    return _exponent;
+}
+
 size_t PointSphere::getHighestStressIndex() {
     std::lock_guard<QMutex> lock(_mtx);
     if (_highestStressIndex != numeric_limits<size_t>::max()) return _highestStressIndex;
 
+    vector<double> stresses = stressMagnitudes();
     double stress = 0;
-    for (size_t i = 0; i < _sideCount; i += 2) {    //skip every other since values will be identical
-        double currentStress = getStress(i,
-                                         false).lengthSquared();  //don't care about actual value so use faster squared value
-        if (currentStress <= stress) continue;
-        stress = currentStress;
-        _highestStressIndex = i;
+    for (size_t i = 0; i < stresses.size(); ++i) {
+        if (stresses[i] <= stress) continue;
+        stress = stresses[i];
+        _highestStressIndex = i * 2;
     }
     return _highestStressIndex;
 }
@@ -301,14 +760,36 @@ size_t PointSphere::getLowestStressIndex() {
     std::lock_guard<QMutex> lock(_mtx);
     if (_lowestStressIndex != numeric_limits<size_t>::max()) return _lowestStressIndex;
 
+    vector<double> stresses = stressMagnitudes();
     double stress = numeric_limits<double>::max();
-    for (size_t i = 0; i < _sideCount; i += 2) {    //skip every other since values will be identical
-        double currentStress = getStress(i,
-                                         false).lengthSquared();  //don't care about actual value so use faster squared value
-        if (currentStress >= stress) continue;
-        stress = currentStress;
-        _lowestStressIndex = i;
+    for (size_t i = 0; i < stresses.size(); ++i) {
+        if (stresses[i] >= stress) continue;
+        stress = stresses[i];
+        _lowestStressIndex = i * 2;
     }
     return _lowestStressIndex;
 }
 
+/**
+ * Squared stress on every stored point (even side indexes, mirrored sides are identical).
+ * Must be called with _mtx held.
+ * @return
+ */
+vector<double> PointSphere::stressMagnitudes() const {
+    vector<double> result(_sideCount / 2);
+    auto compute = [this, &result](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            result[i] = getStress(i * 2, false).lengthSquared();  //don't care about actual value so use faster squared value
+        }
+    };
+    if (_sideCount < PARALLEL_SIDES || _pool == nullptr) {
+        compute(0, result.size());
+    } else {
+        size_t blocks = (result.size() + PAIR_BLOCK_ROWS - 1) / PAIR_BLOCK_ROWS;
+        _pool->parallelFor(blocks, [&compute, &result](size_t block) {
+            size_t first = block * PAIR_BLOCK_ROWS;
+            compute(first, std::min(first + PAIR_BLOCK_ROWS, result.size()));
+        });
+    }
+    return result;
+}
@@ -9,9 +9,14 @@
 #include <limits>
 #include <QMutex>
 #include "Vec3.h"
+#include "RunState.h"
+#include "ThreadPool.h"
 
 using namespace std;
 
+//extension of the exact binary best files, written next to the csv ones
+#define CHECKPOINT_EXTENSION ".bin"
+
 class PointSphere {
     mutable QMutex _mtx;
     size_t _sideCount;
@@ -19,16 +24,32 @@ class PointSphere {
     size_t _lowestStressIndex = numeric_limits<size_t>::max();
     size_t _highestStressIndex = numeric_limits<size_t>::max();
     double _totalStress = numeric_limits<double>::infinity();
+    double _exponent = 2;   //Riesz exponent of the potential, 0 means logarithmic
+    vector<size_t> _externalIndex;  //position in the file of each stored point, empty while in file order
+    vector<bool> _flipped;          //stored point is the mirror image of the one in the file
+    string _loadedFrom;             //source the last load took its points from
+    ThreadPool* _pool = nullptr;    //splits the big sums when set, not copied with the points
+
+    double pairStress(size_t firstRow, size_t lastRow) const;
+    vector<double> stressMagnitudes() const;
 
 public:
     //constructor
     explicit PointSphere(size_t sideCount);
+    PointSphere(size_t sideCount, const vector<Vec3>& points);
     PointSphere(const PointSphere& other);
     PointSphere& operator=(const PointSphere& other);
+    void copyPoints(const PointSphere& other, const vector<size_t>& pointIndices);
 
     //file handler
     double load();
+    const string& loadedFrom() const;
     void save(double rate);
+    static bool writeBest(size_t sideCount, const vector<Vec3>& points, double stress, double rate, bool csv);
+    static void setCsvExport(bool enabled);
+    static double savedStress(size_t sideCount);
+    void writeState(RunState::Writer& state) const;
+    void readState(RunState::Reader& state);
 
     //getter
     Vec3 getPoint(size_t sideIndex) const;
@@ -37,9 +58,16 @@ public:
     size_t sideCount() const;
     size_t getHighestStressIndex();
     size_t getLowestStressIndex();
+    double getExponent() const;
+    size_t externalSide(size_t sideIndex) const;
+    vector<Vec3> externalPoints() const;
+    vector<size_t> curveOrder(vector<bool>& flip) const;
 
     //setter
     void movePoint(size_t sideIndex, const Vec3& value);
+    void setExponent(double exponent);
+    void setPool(ThreadPool* pool);
+    void permute(const vector<size_t>& order, const vector<bool>& flip);
 };
 
 
@@ -0,0 +1,159 @@
+#include "RestartScheduler.h"
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+
+//relative improvement per second below which a run is treated as converged
+#define CONVERGED_RATE 1e-7
+
+//how often a worker's energy is sampled
+#define SAMPLE_SECONDS 0.5
+
+/**
+ * Create a scheduler for a group of workers all optimizing the same side count, using the preset restart timeout
+ * @param sides
+ * @param workerCount
+ */
+RestartScheduler::RestartScheduler(size_t sides, size_t workerCount)
+        : RestartScheduler(sides, workerCount, OptimizerParams::forSides(sides).restartTimeout) {
+}
+
+/**
+ * Create a scheduler with an explicit base restart timeout
+ * @param sides
+ * @param workerCount
+ * @param restartTimeout seconds without a best allowed for a 128 sided die
+ */
+RestartScheduler::RestartScheduler(size_t sides, size_t workerCount, long restartTimeout) : _workers(workerCount) {
+    //small dice converge in seconds, large ones keep improving slowly for minutes
+    double scale = std::max(0.25, std::min(4.0, sqrt(sides / 128.0)));
+    _baseStall = restartTimeout * scale;
+}
+
+/**
+ * Reset a workers statistics when it starts a new die
+ * @param worker
+ */
+void RestartScheduler::beginRun(size_t worker) {
+    std::lock_guard<QMutex> lock(_mtx);
+    _workers[worker] = WorkerStats();
+    _workers[worker].lastSample = std::chrono::steady_clock::now();
+}
+
+/**
+ * Checks if a worker should give up on its die.  Cheap to call often, energy is only sampled every SAMPLE_SECONDS.
+ * @param worker
+ * @param die
+ * @return
+ */
+bool RestartScheduler::shouldRestart(size_t worker, Die& die) {
+    std::lock_guard<QMutex> lock(_mtx);
+    WorkerStats& stats = _workers[worker];
+    auto now = std::chrono::steady_clock::now();
+    double dt = std::chrono::duration<double>(now - stats.lastSample).count();
+    if (dt < SAMPLE_SECONDS) return false;
+    stats.lastSample = now;
+    return sample(worker, die, dt);
+}
+
+/**
+ * Checks if a worker should give up on a die that only runs in slices, such as one of many side counts sharing
+ * the threads.  Rates and stall times are measured in seconds of work rather than seconds of waiting.
+ * @param worker
+ * @param die
+ * @param workSeconds length of the slice just done
+ * @return
+ */
+bool RestartScheduler::shouldRestart(size_t worker, Die& die, double workSeconds) {
+    std::lock_guard<QMutex> lock(_mtx);
+    WorkerStats& stats = _workers[worker];
+    stats.unsampledWork += workSeconds;
+    if (stats.unsampledWork < SAMPLE_SECONDS) return false;
+    double dt = stats.unsampledWork;
+    stats.unsampledWork = 0;
+    return sample(worker, die, dt);
+}
+
+/**
+ * Update a worker's improvement rate and decide if it should restart.  Must be called with _mtx held.
+ * @param worker
+ * @param die
+ * @param seconds time since the last sample
+ * @return
+ */
+bool RestartScheduler::sample(size_t worker, Die& die, double seconds) {
+    WorkerStats& stats = _workers[worker];
+
+    //update smoothed improvement rate
+    double energy = die.getBestStress();
+    if (std::isfinite(stats.lastEnergy)) {
+        double rate = (stats.lastEnergy - energy) / stats.lastEnergy / seconds;
+        stats.rate = (stats.rate < 0) ? rate : 0.7 * stats.rate + 0.3 * rate;
+    }
+    stats.lastEnergy = energy;
+
+    double stall = _baseStall * shareFor(worker);
+    long sinceBest = die.getSecondsSinceLastBest();
+    if (sinceBest >= stall) return true;
+
+    //converged runs are not going anywhere so free the worker early
+    return stats.rate >= 0 && stats.rate < CONVERGED_RATE && sinceBest >= stall / 4;
+}
+
+/**
+ * Seconds without a best a worker is currently allowed
+ * @param worker
+ * @return
+ */
+double RestartScheduler::stallLimit(size_t worker) const {
+    std::lock_guard<QMutex> lock(_mtx);
+    return _baseStall * shareFor(worker);
+}
+
+/**
+ * Store a worker's statistics so a resumed run keeps the time it was given
+ * @param worker
+ * @param state
+ */
+void RestartScheduler::writeState(size_t worker, RunState::Writer& state) const {
+    std::lock_guard<QMutex> lock(_mtx);
+    const WorkerStats& stats = _workers[worker];
+    state.put(std::chrono::duration<double>(std::chrono::steady_clock::now() - stats.lastSample).count());
+    state.put(stats.lastEnergy);
+    state.put(stats.rate);
+}
+
+/**
+ * Restore a worker's statistics in place of beginRun
+ * @param worker
+ * @param state
+ */
+void RestartScheduler::readState(size_t worker, RunState::Reader& state) {
+    auto sinceSample = std::chrono::duration<double>(state.get<double>());
+    WorkerStats stats;
+    stats.lastSample = std::chrono::steady_clock::now() -
+                       std::chrono::duration_cast<std::chrono::steady_clock::duration>(sinceSample);
+    stats.lastEnergy = state.get<double>();
+    stats.rate = state.get<double>();
+    std::lock_guard<QMutex> lock(_mtx);
+    _workers[worker] = stats;
+}
+
+/**
+ * Fraction of the base stall time a worker gets.  Workers improving faster than the median get up to double,
+ * slower ones down to half.  Must be called with _mtx held.
+ * @param worker
+ * @return
+ */
+double RestartScheduler::shareFor(size_t worker) const {
+    if (_workers[worker].rate < 0) return 1.0;
+
+    vector<double> rates;
+    for (const auto& stats: _workers) {
+        if (stats.rate >= 0) rates.push_back(stats.rate);
+    }
+    std::nth_element(rates.begin(), rates.begin() + rates.size() / 2, rates.end());
+    double median = rates[rates.size() / 2];
+    if (median <= 0) return (_workers[worker].rate > 0) ? 2.0 : 1.0;
+    return std::max(0.5, std::min(2.0, _workers[worker].rate / median));
+}
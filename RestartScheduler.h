@@ -0,0 +1,42 @@
+#ifndef DICE_RESTARTSCHEDULER_H
+#define DICE_RESTARTSCHEDULER_H
+
+#include <vector>
+#include <chrono>
+#include <limits>
+#include <QMutex>
+#include "Die.h"
+
+using namespace std;
+
+/**
+ * Decides when a worker should abandon its die and start over.  Stall time allowed scales with side count,
+ * converged runs are dropped early, and workers that are improving faster than their peers get more time.
+ */
+class RestartScheduler {
+    struct WorkerStats {
+        std::chrono::steady_clock::time_point lastSample;
+        double unsampledWork = 0;   //seconds of work since the last sample, for time sliced dice
+        double lastEnergy = numeric_limits<double>::infinity();
+        double rate = -1;   //smoothed relative energy drop per second, negative until measured
+    };
+
+    mutable QMutex _mtx;
+    double _baseStall;
+    vector<WorkerStats> _workers;
+
+    double shareFor(size_t worker) const;
+    bool sample(size_t worker, Die& die, double seconds);
+
+public:
+    RestartScheduler(size_t sides, size_t workerCount);
+    RestartScheduler(size_t sides, size_t workerCount, long restartTimeout);
+    void beginRun(size_t worker);
+    bool shouldRestart(size_t worker, Die& die);
+    bool shouldRestart(size_t worker, Die& die, double workSeconds);
+    double stallLimit(size_t worker) const;
+    void writeState(size_t worker, RunState::Writer& state) const;
+    void readState(size_t worker, RunState::Reader& state);
+};
+
+#endif //DICE_RESTARTSCHEDULER_H
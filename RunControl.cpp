@@ -0,0 +1,77 @@
+#include "RunControl.h"
+
+//longest a blocked thread waits before rechecking for a stop requested from a signal handler
+#define STOP_POLL_MS 250
+
+/**
+ * Park every thread at its next waitWhilePaused
+ */
+void RunControl::pause() {
+    std::lock_guard<std::mutex> lock(_mtx);
+    _paused.store(true);
+}
+
+/**
+ * Let parked threads continue
+ */
+void RunControl::resume() {
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _paused.store(false);
+    }
+    _changed.notify_all();
+}
+
+/**
+ * Ask every thread to finish and wake any that are paused or sleeping
+ */
+void RunControl::stop() {
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _stopping.store(true);
+    }
+    _changed.notify_all();
+}
+
+/**
+ * Stop without locking or notifying, safe to call from a signal handler.  Blocked threads notice within STOP_POLL_MS.
+ */
+void RunControl::requestStop() {
+    _stopping.store(true);
+}
+
+bool RunControl::isPaused() const {
+    return _paused.load();
+}
+
+bool RunControl::isStopping() const {
+    return _stopping.load();
+}
+
+/**
+ * Block while paused
+ * @return false if the thread should exit
+ */
+bool RunControl::waitWhilePaused() {
+    if (!_paused.load()) return !_stopping.load();
+    std::unique_lock<std::mutex> lock(_mtx);
+    while (_paused.load() && !_stopping.load()) {
+        _changed.wait_for(lock, std::chrono::milliseconds(STOP_POLL_MS));
+    }
+    return !_stopping.load();
+}
+
+/**
+ * Sleep that ends early on stop
+ * @param duration
+ * @return false if the thread should exit
+ */
+bool RunControl::sleepFor(std::chrono::milliseconds duration) {
+    auto until = std::chrono::steady_clock::now() + duration;
+    std::unique_lock<std::mutex> lock(_mtx);
+    while (!_stopping.load() && std::chrono::steady_clock::now() < until) {
+        _changed.wait_until(lock, std::min(until, std::chrono::steady_clock::now() +
+                                                  std::chrono::milliseconds(STOP_POLL_MS)));
+    }
+    return !_stopping.load();
+}
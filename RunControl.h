@@ -0,0 +1,32 @@
+#ifndef DICE_RUNCONTROL_H
+#define DICE_RUNCONTROL_H
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+
+/**
+ * Pause, resume and stop for the optimizer threads.  Paused threads block on a condition variable instead of
+ * spinning, and stop wakes everything so threads can finish their last step and exit.
+ */
+class RunControl {
+    std::mutex _mtx;
+    std::condition_variable _changed;
+    std::atomic<bool> _paused{false};
+    std::atomic<bool> _stopping{false};
+
+public:
+    void pause();
+    void resume();
+    void stop();
+    void requestStop();
+
+    bool isPaused() const;
+    bool isStopping() const;
+
+    bool waitWhilePaused();
+    bool sleepFor(std::chrono::milliseconds duration);
+};
+
+#endif //DICE_RUNCONTROL_H
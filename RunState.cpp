@@ -0,0 +1,229 @@
+#include "RunState.h"
+#include "AtomicFile.h"
+#include "Checkpoint.h"
+#include "MappedFile.h"
+#include <filesystem>
+#include <iostream>
+
+/**
+ * @param value
+ */
+void RunState::Writer::putString(const string& value) {
+    put<uint64_t>(value.size());
+    _bytes.append(value);
+}
+
+/**
+ * @param points
+ */
+void RunState::Writer::putPoints(const vector<Vec3>& points) {
+    put<uint64_t>(points.size());
+    for (const auto& point: points) {
+        put(point.x);
+        put(point.y);
+        put(point.z);
+    }
+}
+
+/**
+ * @param indices
+ */
+void RunState::Writer::putIndices(const vector<size_t>& indices) {
+    put<uint64_t>(indices.size());
+    for (size_t index: indices) put<uint64_t>(index);
+}
+
+/**
+ * @param flags
+ */
+void RunState::Writer::putFlags(const vector<bool>& flags) {
+    put<uint64_t>(flags.size());
+    for (bool flag: flags) put<uint8_t>(flag);
+}
+
+const string& RunState::Writer::bytes() const {
+    return _bytes;
+}
+
+RunState::Reader::Reader(const string& bytes) : _pos(bytes.data()), _end(bytes.data() + bytes.size()) {
+}
+
+/**
+ * Throw if fewer bytes are left than a value needs
+ * @param size
+ */
+void RunState::Reader::need(size_t size) const {
+    if (static_cast<size_t>(_end - _pos) < size) throw runtime_error("run state is truncated");
+}
+
+string RunState::Reader::getString() {
+    auto size = get<uint64_t>();
+    need(size);
+    string value(_pos, size);
+    _pos += size;
+    return value;
+}
+
+vector<Vec3> RunState::Reader::getPoints() {
+    auto count = get<uint64_t>();
+    need(count * 3 * sizeof(double));
+    vector<Vec3> points;
+    points.reserve(count);
+    for (uint64_t i = 0; i < count; ++i) {
+        auto x = get<double>();
+        auto y = get<double>();
+        auto z = get<double>();
+        points.emplace_back(x, y, z);
+    }
+    return points;
+}
+
+vector<size_t> RunState::Reader::getIndices() {
+    auto count = get<uint64_t>();
+    need(count * sizeof(uint64_t));
+    vector<size_t> indices(count);
+    for (auto& index: indices) index = get<uint64_t>();
+    return indices;
+}
+
+vector<bool> RunState::Reader::getFlags() {
+    auto count = get<uint64_t>();
+    need(count);
+    vector<bool> flags(count);
+    for (uint64_t i = 0; i < count; ++i) flags[i] = get<uint8_t>() != 0;
+    return flags;
+}
+
+/**
+ * @param sideCount
+ * @param slotCount one per thread that keeps state
+ */
+RunState::RunState(size_t sideCount, size_t slotCount) : _sideCount(sideCount),
+                                                         _generation(new std::atomic<uint64_t>[slotCount]),
+                                                         _slots(slotCount) {
+    for (size_t i = 0; i < slotCount; ++i) _generation[i].store(0);
+}
+
+/**
+ * Path of a side count's run state
+ * @param sideCount
+ * @return
+ */
+string RunState::filename(size_t sideCount) {
+    return "state/" + to_string(sideCount) + ".state";
+}
+
+/**
+ * Read the saved state of this side count so threads can take their slot back with takeRestored.  The last
+ * slot is the polisher's and goes to the last slot whatever the thread count, explorer slots keep their index.
+ * Explorer slots beyond the current thread count are dropped, explorers without a saved slot start fresh.
+ * @return false if there is no valid state file
+ */
+bool RunState::load() {
+    MappedFile file(filename(_sideCount));
+    if (!file.isOpen() || file.size() < sizeof(Header)) return false;
+
+    Header header{};
+    memcpy(&header, file.data(), sizeof(header));
+    if (memcmp(header.magic, RUN_STATE_MAGIC, sizeof(header.magic)) != 0) return false;
+    if (header.version != RUN_STATE_VERSION || header.sideCount != _sideCount) return false;
+    const unsigned char* body = file.data() + sizeof(Header);
+    size_t bodySize = file.size() - sizeof(Header);
+    if (Checkpoint::fnv1a(body, bodySize) != header.checksum) return false;
+
+    try {
+        Reader reader(string(reinterpret_cast<const char*>(body), bodySize));
+        vector<string> saved;
+        for (uint64_t i = 0; i < header.slotCount; ++i) saved.push_back(reader.getString());
+        vector<string> slots(_slots.size());
+        if (!saved.empty() && !slots.empty()) {
+            slots.back() = std::move(saved.back());
+            for (size_t i = 0; i + 1 < saved.size() && i + 1 < slots.size(); ++i) slots[i] = std::move(saved[i]);
+        }
+        std::lock_guard<std::mutex> lock(_mtx);
+        _slots = slots;     //kept for threads that stop before taking theirs back
+        _restored = std::move(slots);
+    } catch (const runtime_error&) {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Saved state of a slot, empty if there is none.  Only returned once so a thread that later starts a new die
+ * does not restore the old one again.
+ * @param slot
+ * @return
+ */
+string RunState::takeRestored(size_t slot) {
+    std::lock_guard<std::mutex> lock(_mtx);
+    if (slot >= _restored.size()) return "";
+    return std::move(_restored[slot]);
+}
+
+/**
+ * Has a snapshot been asked for that this slot has not handed in yet.  Cheap enough to call between steps.
+ * @param slot
+ * @return
+ */
+bool RunState::wanted(size_t slot) const {
+    return _generation[slot].load(std::memory_order_relaxed) != _requested.load(std::memory_order_relaxed);
+}
+
+/**
+ * Hand in the state of a slot for the current request
+ * @param slot
+ * @param bytes
+ */
+void RunState::provide(size_t slot, string bytes) {
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _slots[slot] = std::move(bytes);
+        _generation[slot].store(_requested.load());
+    }
+    _provided.notify_all();
+}
+
+/**
+ * Ask every slot for its state and write the file once all have answered
+ * @param timeout how long to wait for slow threads, nothing is written if one does not answer in time
+ * @return true if the file was written
+ */
+bool RunState::save(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(_mtx);
+    uint64_t request = _requested.fetch_add(1) + 1;
+    bool complete = _provided.wait_for(lock, timeout, [&] {
+        for (size_t i = 0; i < _slots.size(); ++i) {
+            if (_generation[i].load() != request) return false;
+        }
+        return true;
+    });
+    if (!complete) return false;
+    lock.unlock();
+    return write();
+}
+
+/**
+ * Write the slots as they were last handed in, used once the threads have stopped and handed in their
+ * final state
+ * @return true if the file was written
+ */
+bool RunState::write() {
+    Writer body;
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        for (const auto& slot: _slots) body.putString(slot);
+    }
+
+    Header header{};
+    memcpy(header.magic, RUN_STATE_MAGIC, sizeof(header.magic));
+    header.version = RUN_STATE_VERSION;
+    header.sideCount = _sideCount;
+    header.slotCount = _slots.size();
+    header.checksum = Checkpoint::fnv1a(body.bytes().data(), body.bytes().size());
+
+    std::filesystem::create_directories("state");
+    string bytes(reinterpret_cast<const char*>(&header), sizeof(header));
+    bytes.append(body.bytes());
+    return AtomicFile::write(filename(_sideCount), bytes);
+}
@@ -0,0 +1,102 @@
+#ifndef DICE_RUNSTATE_H
+#define DICE_RUNSTATE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "Vec3.h"
+
+using namespace std;
+
+//first bytes of every run state file
+#define RUN_STATE_MAGIC "DRUN"
+
+//bumped whenever the layout of the file or of any slot changes, older versions are rejected
+#define RUN_STATE_VERSION 2
+
+/**
+ * Complete optimizer state of a run, so a run that is stopped can carry on exactly where it was.  The state is
+ * split into slots, one per optimizing thread, and each thread writes its own slot between steps when asked.
+ * The last slot always belongs to the polisher, so a run can resume with a different thread count.
+ * Nothing is ever stopped to take a snapshot, the saver just waits for every thread to hand its slot in.
+ * Slots are plain bytes built with Writer and read back with Reader, all little endian.
+ */
+class RunState {
+public:
+    class Writer {
+        string _bytes;
+
+    public:
+        template<typename T>
+        void put(const T& value) {
+            _bytes.append(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        void putString(const string& value);
+        void putPoints(const vector<Vec3>& points);
+        void putIndices(const vector<size_t>& indices);
+        void putFlags(const vector<bool>& flags);
+        const string& bytes() const;
+    };
+
+    class Reader {
+        const char* _pos;
+        const char* _end;
+
+        void need(size_t size) const;
+
+    public:
+        explicit Reader(const string& bytes);
+
+        template<typename T>
+        T get() {
+            need(sizeof(T));
+            T value;
+            memcpy(&value, _pos, sizeof(T));
+            _pos += sizeof(T);
+            return value;
+        }
+
+        string getString();
+        vector<Vec3> getPoints();
+        vector<size_t> getIndices();
+        vector<bool> getFlags();
+    };
+
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint64_t sideCount;
+        uint64_t slotCount;
+        uint64_t checksum;      //FNV-1a of everything after the header
+    };
+
+    RunState(size_t sideCount, size_t slotCount);
+
+    static string filename(size_t sideCount);
+    bool load();
+    string takeRestored(size_t slot);
+
+    bool wanted(size_t slot) const;
+    void provide(size_t slot, string bytes);
+    bool save(std::chrono::milliseconds timeout);
+    bool write();
+
+private:
+    size_t _sideCount;
+    vector<string> _restored;           //slots read from disk, each handed out once
+    std::mutex _mtx;
+    std::condition_variable _provided;
+    std::atomic<uint64_t> _requested{0};
+    unique_ptr<std::atomic<uint64_t>[]> _generation;   //request each slot last answered
+    vector<string> _slots;
+};
+
+#endif //DICE_RUNSTATE_H
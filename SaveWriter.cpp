@@ -0,0 +1,109 @@
+#include "SaveWriter.h"
+#include "PointSphere.h"
+#include <filesystem>
+
+/**
+ * Writer shared by the whole program
+ * @return
+ */
+SaveWriter& SaveWriter::instance() {
+    static SaveWriter writer;
+    return writer;
+}
+
+SaveWriter::SaveWriter() {
+    _thread = std::thread(&SaveWriter::run, this);
+}
+
+/**
+ * Writes whatever is still queued before the program exits
+ */
+SaveWriter::~SaveWriter() {
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _stopping = true;
+    }
+    _wake.notify_all();
+    _thread.join();
+}
+
+/**
+ * Would a result with this energy be written.  Cheap, so savers can skip copying points that would be dropped.
+ * @param sideCount
+ * @param stress
+ * @return true if it beats both the file on disk and anything already queued
+ */
+bool SaveWriter::isImprovement(size_t sideCount, double stress) {
+    std::lock_guard<std::mutex> lock(_mtx);
+    auto queued = _pending.find(sideCount);
+    if (queued != _pending.end() && stress >= queued->second.stress) return false;
+    auto persisted = _persisted.find(sideCount);
+    return persisted == _persisted.end() || stress < persisted->second;
+}
+
+/**
+ * Queue a result to be written.  Replaces a queued result of the same side count if it is lower.
+ * @param snapshot
+ */
+void SaveWriter::submit(Snapshot snapshot) {
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        auto persisted = _persisted.find(snapshot.sideCount);
+        if (persisted != _persisted.end() && snapshot.stress >= persisted->second) return;
+        auto queued = _pending.find(snapshot.sideCount);
+        if (queued == _pending.end()) {
+            _pending.emplace(snapshot.sideCount, std::move(snapshot));
+        } else if (snapshot.stress < queued->second.stress) {
+            queued->second = std::move(snapshot);
+        } else {
+            return;
+        }
+    }
+    _wake.notify_one();
+}
+
+/**
+ * Wait until everything queued so far is on disk
+ */
+void SaveWriter::flush() {
+    std::unique_lock<std::mutex> lock(_mtx);
+    _idle.wait(lock, [this] { return _pending.empty() && !_busy; });
+}
+
+/**
+ * Writer thread, takes one side count at a time off the queue
+ */
+void SaveWriter::run() {
+    std::unique_lock<std::mutex> lock(_mtx);
+    while (true) {
+        _wake.wait(lock, [this] { return _stopping || !_pending.empty(); });
+        if (_pending.empty()) return;
+
+        Snapshot snapshot = std::move(_pending.begin()->second);
+        _pending.erase(_pending.begin());
+        _busy = true;
+        lock.unlock();
+        write(snapshot);
+        lock.lock();
+        _busy = false;
+        if (_pending.empty()) _idle.notify_all();
+    }
+}
+
+/**
+ * Write a snapshot if it is still better than what is on disk.  The files are read again before writing in
+ * case another process saved a better result since the energy was cached.
+ * @param snapshot
+ */
+void SaveWriter::write(const Snapshot& snapshot) {
+    double onDisk = PointSphere::savedStress(snapshot.sideCount);
+    if (snapshot.stress < onDisk) {
+        std::filesystem::create_directories("best");
+        if (PointSphere::writeBest(snapshot.sideCount, snapshot.points, snapshot.stress, snapshot.rate,
+                                   snapshot.csv)) {
+            onDisk = snapshot.stress;
+        }
+    }
+    std::lock_guard<std::mutex> lock(_mtx);
+    _persisted[snapshot.sideCount] = onDisk;
+}
@@ -0,0 +1,54 @@
+#ifndef DICE_SAVEWRITER_H
+#define DICE_SAVEWRITER_H
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Vec3.h"
+
+using namespace std;
+
+/**
+ * Writes best results on its own thread so optimizers never wait on the disk.  Savers hand over a snapshot
+ * and return at once.  Snapshots of the same side count that pile up while the writer is busy are coalesced
+ * so only the lowest energy one is written.  The energy on disk of each side count is remembered, so a
+ * snapshot that is no improvement is dropped without reading the best files again.
+ */
+class SaveWriter {
+public:
+    struct Snapshot {
+        size_t sideCount;
+        vector<Vec3> points;        //stored points in file order
+        double stress;
+        double rate;
+        bool csv;                   //also write the csv file
+    };
+
+private:
+    std::mutex _mtx;
+    std::condition_variable _wake;
+    std::condition_variable _idle;
+    map<size_t, Snapshot> _pending;
+    map<size_t, double> _persisted;     //energy on disk, only known once the writer has looked
+    bool _busy = false;
+    bool _stopping = false;
+    std::thread _thread;
+
+    SaveWriter();
+    void run();
+    void write(const Snapshot& snapshot);
+
+public:
+    static SaveWriter& instance();
+    ~SaveWriter();
+    SaveWriter(const SaveWriter&) = delete;
+    SaveWriter& operator=(const SaveWriter&) = delete;
+
+    bool isImprovement(size_t sideCount, double stress);
+    void submit(Snapshot snapshot);
+    void flush();
+};
+
+#endif //DICE_SAVEWRITER_H
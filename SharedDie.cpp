@@ -0,0 +1,267 @@
+#include "SharedDie.h"
+#include "OptimizerParams.h"
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+
+//points closer than this many typical spacings to the moved point are checked for changes before a commit
+#define NEIGHBOUR_SPACINGS 3
+
+//times a move is recomputed from a fresh snapshot after a conflict before giving up on it
+#define COMMIT_ATTEMPTS 4
+
+//move rate is scaled by these after a committed and a rejected move
+#define ACCEPT_SCALE 1.2
+#define REJECT_SCALE 0.7
+
+/**
+ * Create a shared die
+ * @param sides
+ * @param loadBest start from the saved best if there is one
+ */
+SharedDie::SharedDie(size_t sides, bool loadBest) : _sideCount(sides), _pointCount(sides / 2),
+                                                    _slots(new Slot[sides / 2]), _best(sides),
+                                                    _lastBestTime(std::chrono::steady_clock::now()) {
+    _bestRate = OptimizerParams::forSides(sides).startRate / sides;
+    if (loadBest) {
+        try {
+            _bestRate = _best.load();
+        } catch (...) {
+        }
+    }
+    for (size_t i = 0; i < _pointCount; ++i) {
+        Vec3 point = _best.getPoint(i * 2);
+        _slots[i].x.store(point.x);
+        _slots[i].y.store(point.y);
+        _slots[i].z.store(point.z);
+    }
+    _bestStress = _best.getTotalStress();
+    _stress.store(_bestStress);
+
+    //points spread evenly on a hexagonal grid are about sqrt(8 pi / (sqrt(3) sides)) apart
+    double spacingSquared = 8 * M_PI / (sqrt(3.0) * sides);
+    _neighbourDistanceSquared = NEIGHBOUR_SPACINGS * NEIGHBOUR_SPACINGS * spacingSquared;
+}
+
+/**
+ * Set up a worker before its first optimize call
+ * @param worker
+ */
+void SharedDie::initWorker(Worker& worker) const {
+    std::lock_guard<QMutex> lock(_bestMutex);
+    worker.moveRate = _bestRate;
+    worker.points.resize(_pointCount);
+    worker.versions.resize(_pointCount);
+}
+
+/**
+ * Copy every point into the worker's snapshot.  Each point is read consistently, the snapshot as a whole
+ * may mix points from before and after other threads' commits.
+ * @param worker
+ */
+void SharedDie::readPoints(Worker& worker) const {
+    for (size_t i = 0; i < _pointCount; ++i) {
+        const Slot& slot = _slots[i];
+        while (true) {
+            uint64_t before = slot.version.load(std::memory_order_acquire);
+            if (before % 2 == 1) continue;  //being written
+            Vec3 point(slot.x.load(std::memory_order_relaxed), slot.y.load(std::memory_order_relaxed),
+                       slot.z.load(std::memory_order_relaxed));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.version.load(std::memory_order_relaxed) != before) continue;
+            worker.points[i] = point;
+            worker.versions[i] = before;
+            break;
+        }
+    }
+}
+
+/**
+ * Try to move one point.  The point is pushed along the force on it and the move is kept only if it lowers
+ * the energy and its neighbourhood has not changed since it was read.
+ * @param worker
+ */
+void SharedDie::optimize(Worker& worker) {
+    size_t index = std::uniform_int_distribution<size_t>(0, _pointCount - 1)(worker.rng);
+
+    for (unsigned int attempt = 0; attempt < COMMIT_ATTEMPTS; ++attempt) {
+        readPoints(worker);
+        const Vec3 current = worker.points[index];
+
+        //force from every other point and its mirror image
+        Vec3 force(0, 0, 0);
+        for (size_t j = 0; j < _pointCount; ++j) {
+            if (j == index) continue;
+            Vec3 toPoint = current - worker.points[j];
+            Vec3 toMirror = current + worker.points[j];
+            double pointSquared = toPoint.lengthSquared();
+            double mirrorSquared = toMirror.lengthSquared();
+            if (pointSquared > 0) force += toPoint / (pointSquared * sqrt(pointSquared));
+            if (mirrorSquared > 0) force += toMirror / (mirrorSquared * sqrt(mirrorSquared));
+        }
+        Vec3 proposed = current + force * worker.moveRate;
+        proposed.normalize();
+
+        //energy change, each stored pair stands for two pairs of sides.  Also collect the neighbourhood.
+        double delta = 0;
+        worker.neighbours.clear();
+        for (size_t j = 0; j < _pointCount; ++j) {
+            if (j == index) {
+                worker.neighbours.push_back(j);
+                continue;
+            }
+            const Vec3& other = worker.points[j];
+            double newPoint = (proposed - other).lengthSquared();
+            double newMirror = (proposed + other).lengthSquared();
+            double oldPoint = (current - other).lengthSquared();
+            double oldMirror = (current + other).lengthSquared();
+            if (newPoint == 0 || newMirror == 0) {
+                delta = numeric_limits<double>::infinity();
+                break;
+            }
+            delta += 2 * (1 / newPoint + 1 / newMirror - 1 / oldPoint - 1 / oldMirror);
+            if (std::min({newPoint, newMirror, oldPoint, oldMirror}) < _neighbourDistanceSquared) {
+                worker.neighbours.push_back(j);
+            }
+        }
+
+        if (!(delta < 0)) {
+            _rejects.fetch_add(1);
+            worker.moveRate = std::max(worker.moveRate * REJECT_SCALE, 1.0 / _sideCount / _sideCount);
+            break;
+        }
+        if (!commit(worker, index, proposed)) {
+            _conflicts.fetch_add(1);
+            continue;
+        }
+
+        double stress = _stress.load();
+        while (!_stress.compare_exchange_weak(stress, stress + delta)) {}
+        _commits.fetch_add(1);
+        worker.moveRate = std::min(worker.moveRate * ACCEPT_SCALE, 1.0);
+        break;
+    }
+
+    //every so often score the snapshot exactly and keep it if it is the best yet
+    if (++worker.movesSinceCheck >= _pointCount) {
+        worker.movesSinceCheck = 0;
+        checkBest(worker);
+    }
+}
+
+/**
+ * Lock the moved point and its neighbourhood at the versions the worker read, then write the point.  Locks
+ * are taken in index order, which worker.neighbours already is, and fail instead of waiting.
+ * @param worker
+ * @param index
+ * @param point
+ * @return false if anything in the neighbourhood changed or is being changed
+ */
+bool SharedDie::commit(Worker& worker, size_t index, const Vec3& point) {
+    size_t lockedCount = 0;
+    for (size_t j: worker.neighbours) {
+        uint64_t expected = worker.versions[j];
+        if (!_slots[j].version.compare_exchange_strong(expected, expected + 1, std::memory_order_acquire)) {
+            unlock(worker, lockedCount);
+            return false;
+        }
+        ++lockedCount;
+    }
+
+    Slot& slot = _slots[index];
+    slot.x.store(point.x, std::memory_order_relaxed);
+    slot.y.store(point.y, std::memory_order_relaxed);
+    slot.z.store(point.z, std::memory_order_relaxed);
+    worker.versions[index] += 2;
+
+    unlock(worker, lockedCount);
+    return true;
+}
+
+/**
+ * Release the first count points of the worker's neighbourhood, setting each back to the even version in the
+ * worker's snapshot
+ * @param worker
+ * @param count
+ */
+void SharedDie::unlock(const Worker& worker, size_t count) const {
+    for (size_t i = 0; i < count; ++i) {
+        size_t j = worker.neighbours[i];
+        _slots[j].version.store(worker.versions[j], std::memory_order_release);
+    }
+}
+
+/**
+ * Score the worker's snapshot exactly.  Any set of points is a valid die, so the snapshot does not need to
+ * match one moment in time.  Also resyncs the running total, which drifts because far points are not
+ * checked before a commit.
+ * @param worker
+ */
+void SharedDie::checkBest(Worker& worker) {
+    PointSphere candidate(_sideCount, worker.points);
+    double stress = candidate.getTotalStress();
+    _stress.store(stress);
+
+    std::lock_guard<QMutex> lock(_bestMutex);
+    if (stress >= _bestStress) return;
+    _best = candidate;
+    _bestStress = stress;
+    _bestRate = worker.moveRate;
+    _lastBestTime = std::chrono::steady_clock::now();
+    _version.fetch_add(1);
+}
+
+/**
+ * Running total energy of the shared configuration, approximate between exact checks
+ * @return
+ */
+double SharedDie::getStress() const {
+    return _stress.load();
+}
+
+double SharedDie::getBestStress() const {
+    std::lock_guard<QMutex> lock(_bestMutex);
+    return _bestStress;
+}
+
+PointSphere SharedDie::getBest() const {
+    std::lock_guard<QMutex> lock(_bestMutex);
+    return _best;
+}
+
+/**
+ * Number of times the best configuration has changed
+ * @return
+ */
+uint64_t SharedDie::getVersion() const {
+    return _version.load();
+}
+
+long SharedDie::getSecondsSinceLastBest() const {
+    std::lock_guard<QMutex> lock(_bestMutex);
+    auto now = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::seconds>(now - _lastBestTime).count();
+}
+
+uint64_t SharedDie::getCommits() const {
+    return _commits.load();
+}
+
+uint64_t SharedDie::getConflicts() const {
+    return _conflicts.load();
+}
+
+uint64_t SharedDie::getRejects() const {
+    return _rejects.load();
+}
+
+/**
+ * Write the best configuration to best/ if it beats what is there
+ */
+void SharedDie::save() {
+    std::unique_lock<QMutex> lock(_bestMutex);
+    PointSphere best(_best);
+    double rate = _bestRate;
+    lock.unlock();
+    best.save(rate);
+}
@@ -0,0 +1,82 @@
+#ifndef DICE_SHAREDDIE_H
+#define DICE_SHAREDDIE_H
+
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <QMutex>
+#include "PointSphere.h"
+#include "Vec3.h"
+
+using namespace std;
+
+/**
+ * One configuration optimized by many threads at once.  Each thread moves one point at a time, working from
+ * its own snapshot of the points.  Every point carries a version stamp that is odd while the point is being
+ * written.  A move is committed by locking the moved point and its near neighbours at the versions the
+ * snapshot saw, so a move computed against neighbours that changed in the meantime is thrown away and retried
+ * instead of committed.  Far away points only change the energy delta slightly, so they are not checked.
+ * Only moves that lower the energy are committed.
+ */
+class SharedDie {
+public:
+    //state each optimizing thread keeps for itself
+    struct Worker {
+        mt19937 rng;
+        double moveRate;
+        size_t movesSinceCheck = 0;
+        vector<Vec3> points;            //snapshot of the stored points
+        vector<uint64_t> versions;      //version of each point when it was read
+        vector<size_t> neighbours;
+
+        explicit Worker(unsigned int seed) : rng(seed), moveRate(0) {}
+    };
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> version{0};
+        std::atomic<double> x{0}, y{0}, z{0};
+    };
+
+    size_t _sideCount;
+    size_t _pointCount;
+    unique_ptr<Slot[]> _slots;
+    double _neighbourDistanceSquared;
+
+    std::atomic<double> _stress;            //running total, committed deltas are added to it
+    std::atomic<uint64_t> _commits{0};
+    std::atomic<uint64_t> _conflicts{0};
+    std::atomic<uint64_t> _rejects{0};
+
+    mutable QMutex _bestMutex;
+    PointSphere _best;
+    double _bestStress;
+    double _bestRate;
+    std::chrono::steady_clock::time_point _lastBestTime;
+    std::atomic<uint64_t> _version{0};
+
+    void readPoints(Worker& worker) const;
+    bool commit(Worker& worker, size_t index, const Vec3& point);
+    void unlock(const Worker& worker, size_t count) const;
+    void checkBest(Worker& worker);
+
+public:
+    SharedDie(size_t sides, bool loadBest);
+
+    void optimize(Worker& worker);
+    void initWorker(Worker& worker) const;
+
+    double getStress() const;
+    double getBestStress() const;
+    PointSphere getBest() const;
+    uint64_t getVersion() const;
+    long getSecondsSinceLastBest() const;
+    uint64_t getCommits() const;
+    uint64_t getConflicts() const;
+    uint64_t getRejects() const;
+    void save();
+};
+
+#endif //DICE_SHAREDDIE_H
@@ -0,0 +1,104 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+/**
+ * Start a pool
+ * @param threadCount number of helper threads, callers of parallelFor work as well
+ */
+ThreadPool::ThreadPool(size_t threadCount) {
+    for (size_t i = 0; i < threadCount; ++i) {
+        _threads.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _stopping = true;
+    }
+    _workAvailable.notify_all();
+    for (auto& thread: _threads) thread.join();
+}
+
+/**
+ * Pool shared by the whole program, one helper per core besides the caller
+ * @return
+ */
+ThreadPool& ThreadPool::instance() {
+    static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return pool;
+}
+
+/**
+ * Number of helper threads
+ * @return
+ */
+size_t ThreadPool::threadCount() const {
+    return _threads.size();
+}
+
+/**
+ * Run body(block) for every block in [0, blocks) and wait for all of them to finish
+ * @param blocks
+ * @param body
+ */
+void ThreadPool::parallelFor(size_t blocks, const function<void(size_t)>& body) {
+    if (blocks == 0) return;
+    if (blocks == 1 || _threads.empty()) {
+        for (size_t block = 0; block < blocks; ++block) body(block);
+        return;
+    }
+
+    auto job = std::make_shared<Job>();
+    job->body = &body;
+    job->blocks = blocks;
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _jobs.push_back(job);
+    }
+    _workAvailable.notify_all();
+
+    //help out then wait for blocks other threads picked up
+    runBlocks(*job);
+    std::unique_lock<std::mutex> lock(_mtx);
+    _jobDone.wait(lock, [&job]() { return job->done.load() == job->blocks; });
+    auto it = std::find(_jobs.begin(), _jobs.end(), job);
+    if (it != _jobs.end()) _jobs.erase(it);
+}
+
+/**
+ * Claim and run blocks of a job until none are left
+ * @param job
+ */
+void ThreadPool::runBlocks(Job& job) {
+    size_t block;
+    while ((block = job.next.fetch_add(1)) < job.blocks) {
+        (*job.body)(block);
+        if (job.done.fetch_add(1) + 1 == job.blocks) {
+            std::lock_guard<std::mutex> lock(_mtx);
+            _jobDone.notify_all();
+        }
+    }
+}
+
+/**
+ * Helper thread body, works on the oldest job that still has unclaimed blocks
+ */
+void ThreadPool::workerLoop() {
+    while (true) {
+        shared_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lock(_mtx);
+            _workAvailable.wait(lock, [this]() { return _stopping || !_jobs.empty(); });
+            if (_stopping) return;
+            job = _jobs.front();
+
+            //every block is claimed so nobody else needs to see it
+            if (job->next.load() >= job->blocks) {
+                _jobs.pop_front();
+                continue;
+            }
+        }
+        runBlocks(*job);
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef DICE_THREADPOOL_H
+#define DICE_THREADPOOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <condition_variable>
+
+using namespace std;
+
+/**
+ * Shared pool used to split one large calculation across cores.  Work is cut into blocks whose boundaries
+ * are chosen by the caller, so results reduced in block order do not depend on how many threads ran them.
+ * Several threads may call parallelFor at once; each caller also works on its own blocks so it never waits idle.
+ */
+class ThreadPool {
+    struct Job {
+        const function<void(size_t)>* body;
+        size_t blocks;
+        atomic<size_t> next{0};
+        atomic<size_t> done{0};
+    };
+
+    std::mutex _mtx;
+    std::condition_variable _workAvailable;
+    std::condition_variable _jobDone;
+    deque<shared_ptr<Job>> _jobs;
+    vector<std::thread> _threads;
+    bool _stopping = false;
+
+    void workerLoop();
+    void runBlocks(Job& job);
+
+public:
+    explicit ThreadPool(size_t threadCount);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    static ThreadPool& instance();
+    size_t threadCount() const;
+    void parallelFor(size_t blocks, const function<void(size_t)>& body);
+};
+
+#endif //DICE_THREADPOOL_H
@@ -0,0 +1,198 @@
+#include "TrajectoryLog.h"
+#include "Die.h"
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+//how often the rings are written out
+#define FLUSH_SECONDS 1
+
+//shortest time between two samples of the same worker
+#define SAMPLE_INTERVAL_NS 100000000ull
+
+static_assert(sizeof(TrajectoryLog::Record) == 48, "log records are written as raw bytes");
+
+/**
+ * Start a log.  The file is created straight away so a run that cannot write its log says so at startup.
+ * @param sideCount
+ * @param workerCount one ring per worker
+ * @param filename
+ */
+TrajectoryLog::TrajectoryLog(size_t sideCount, size_t workerCount, const string& filename)
+        : _start(std::chrono::steady_clock::now()) {
+    for (size_t i = 0; i < workerCount; ++i) _rings.push_back(std::make_unique<Ring>());
+
+    std::filesystem::path directory = std::filesystem::path(filename).parent_path();
+    if (!directory.empty()) std::filesystem::create_directories(directory);
+    _file = fopen(filename.c_str(), "wb");
+    if (_file == nullptr) {
+        cerr << "Unable to open file for writing: " << filename << endl;
+    } else {
+        Header header{};
+        memcpy(header.magic, TRAJECTORY_MAGIC, sizeof(header.magic));
+        header.version = TRAJECTORY_VERSION;
+        header.sideCount = sideCount;
+        header.startTime = static_cast<int64_t>(std::time(nullptr));
+        fwrite(&header, sizeof(header), 1, _file);
+    }
+    _flusher = std::thread(&TrajectoryLog::run, this);
+}
+
+/**
+ * Writes whatever the workers recorded last.  Workers must have stopped recording.
+ */
+TrajectoryLog::~TrajectoryLog() {
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _stopping = true;
+    }
+    _wake.notify_all();
+    _flusher.join();
+    flush();
+    if (_file != nullptr) fclose(_file);
+}
+
+/**
+ * Path of a new log for a side count, named after the time the run started
+ * @param sideCount
+ * @return
+ */
+string TrajectoryLog::defaultFilename(size_t sideCount) {
+    return "logs/" + to_string(sideCount) + "-" + to_string(std::time(nullptr)) + ".dlog";
+}
+
+/**
+ * Add a record to a worker's ring.  Only the worker itself may call this for its index.
+ * @param worker
+ * @param event
+ * @param energy
+ * @param moveRate
+ * @param accepted
+ * @param rejected
+ */
+void TrajectoryLog::record(size_t worker, Event event, double energy, double moveRate, uint64_t accepted,
+                           uint64_t rejected) {
+    Ring& ring = *_rings[worker];
+    uint64_t head = ring.head.load(std::memory_order_relaxed);
+    if (head - ring.tail.load(std::memory_order_acquire) >= TRAJECTORY_RING_SIZE) {
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    Record& record = ring.records[head % TRAJECTORY_RING_SIZE];
+    record.timeNs = elapsedNs();
+    record.energy = energy;
+    record.moveRate = moveRate;
+    record.accepted = accepted;
+    record.rejected = rejected;
+    record.worker = static_cast<uint32_t>(worker);
+    record.event = static_cast<uint8_t>(event);
+    memset(record.padding, 0, sizeof(record.padding));
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+/**
+ * Record the state of a worker's die if its last sample is old enough.  Cheap to call after every batch of
+ * moves, it only reads the clock unless a sample is due.
+ * @param worker
+ * @param die
+ */
+void TrajectoryLog::sample(size_t worker, Die& die) {
+    Ring& ring = *_rings[worker];
+    uint64_t now = elapsedNs();
+    if (now < ring.nextSampleNs) return;
+    ring.nextSampleNs = now + SAMPLE_INTERVAL_NS;
+
+    uint64_t version = die.getVersion();
+    Event event = version != ring.lastVersion ? Event::Best : Event::Sample;
+    ring.lastVersion = version;
+    record(worker, event, die.getBestStress(), die.getMoveRate(), die.getAccepted(), die.getRejected());
+}
+
+/**
+ * Record that a worker started on a new die
+ * @param worker
+ * @param die
+ */
+void TrajectoryLog::restart(size_t worker, Die& die) {
+    Ring& ring = *_rings[worker];
+    ring.lastVersion = die.getVersion();
+    record(worker, Event::Restart, die.getBestStress(), die.getMoveRate(), die.getAccepted(), die.getRejected());
+}
+
+uint64_t TrajectoryLog::elapsedNs() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _start).count();
+}
+
+/**
+ * Records lost because a ring was full
+ * @return
+ */
+uint64_t TrajectoryLog::dropped() const {
+    return _dropped.load();
+}
+
+/**
+ * Flusher thread
+ */
+void TrajectoryLog::run() {
+    std::unique_lock<std::mutex> lock(_mtx);
+    while (!_wake.wait_for(lock, std::chrono::seconds(FLUSH_SECONDS), [this] { return _stopping; })) {
+        lock.unlock();
+        flush();
+        lock.lock();
+    }
+}
+
+/**
+ * Append every record waiting in the rings to the file.  Only called by one thread at a time.
+ */
+void TrajectoryLog::flush() {
+    for (auto& ring: _rings) {
+        uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        while (tail != head) {
+            //write up to the end of the ring in one go, then wrap
+            uint64_t start = tail % TRAJECTORY_RING_SIZE;
+            uint64_t count = std::min<uint64_t>(head - tail, TRAJECTORY_RING_SIZE - start);
+            if (_file != nullptr) fwrite(&ring->records[start], sizeof(Record), count, _file);
+            tail += count;
+        }
+        ring->tail.store(tail, std::memory_order_release);
+    }
+    if (_file != nullptr) fflush(_file);
+}
+
+/**
+ * Convert a log to csv, one line per record
+ * @param logFile
+ * @param csvFile
+ * @return false if the log could not be read or the csv written
+ */
+bool TrajectoryLog::toCsv(const string& logFile, const string& csvFile) {
+    ifstream in(logFile, ios::binary);
+    Header header{};
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        memcmp(header.magic, TRAJECTORY_MAGIC, sizeof(header.magic)) != 0 || header.version != TRAJECTORY_VERSION) {
+        cerr << "Not a trajectory log: " << logFile << endl;
+        return false;
+    }
+
+    ofstream out(csvFile);
+    if (!out.is_open()) {
+        cerr << "Unable to open file for writing: " << csvFile << endl;
+        return false;
+    }
+    static const char* eventNames[] = {"sample", "best", "restart"};
+    out << "time,worker,event,energy,rate,accepted,rejected" << "\n";
+    Record record{};
+    while (in.read(reinterpret_cast<char*>(&record), sizeof(record))) {
+        const char* event = record.event < 3 ? eventNames[record.event] : "unknown";
+        out << fixed << setprecision(3) << record.timeNs / 1e9 << "," << record.worker << "," << event << ","
+            << defaultfloat << setprecision(15) << record.energy << "," << record.moveRate << "," << record.accepted << "," << record.rejected << "\n";
+    }
+    return out.good();
+}
@@ -0,0 +1,96 @@
+#ifndef DICE_TRAJECTORYLOG_H
+#define DICE_TRAJECTORYLOG_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+class Die;
+
+//first bytes of every trajectory log
+#define TRAJECTORY_MAGIC "DLOG"
+
+//bumped whenever the record layout changes
+#define TRAJECTORY_VERSION 1
+
+//records each worker can hold before the flusher empties them, must be a power of 2
+#define TRAJECTORY_RING_SIZE 4096
+
+/**
+ * Binary record of how a run progressed.  Every worker writes fixed size records into its own ring buffer,
+ * which only costs a few stores, and a background thread appends them all to the log file once a second.
+ * Records that would overflow a full ring are counted and dropped rather than making the worker wait.
+ */
+class TrajectoryLog {
+public:
+    enum class Event : uint8_t {
+        Sample = 0,     //periodic sample, nothing new since the last one
+        Best = 1,       //periodic sample, the die found a better configuration since the last one
+        Restart = 2     //worker started a new die
+    };
+
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint64_t sideCount;
+        int64_t startTime;      //unix time the run started
+    };
+
+    struct Record {
+        uint64_t timeNs;        //since the run started
+        double energy;          //best energy of the worker's die
+        double moveRate;
+        uint64_t accepted;      //moves of the die that improved on its best
+        uint64_t rejected;      //moves that did not
+        uint32_t worker;
+        uint8_t event;
+        uint8_t padding[3];
+    };
+
+    TrajectoryLog(size_t sideCount, size_t workerCount, const string& filename);
+    ~TrajectoryLog();
+    TrajectoryLog(const TrajectoryLog&) = delete;
+    TrajectoryLog& operator=(const TrajectoryLog&) = delete;
+
+    static string defaultFilename(size_t sideCount);
+    static bool toCsv(const string& logFile, const string& csvFile);
+
+    void record(size_t worker, Event event, double energy, double moveRate, uint64_t accepted, uint64_t rejected);
+    void sample(size_t worker, Die& die);
+    void restart(size_t worker, Die& die);
+    uint64_t dropped() const;
+
+private:
+    //single producer, single consumer ring of one worker
+    struct alignas(64) Ring {
+        Record records[TRAJECTORY_RING_SIZE];
+        alignas(64) std::atomic<uint64_t> head{0};  //next record the worker writes
+        uint64_t nextSampleNs = 0;                  //worker only
+        uint64_t lastVersion = 0;                   //worker only, version of the die at the last sample
+        alignas(64) std::atomic<uint64_t> tail{0};  //next record the flusher reads
+    };
+
+    std::chrono::steady_clock::time_point _start;
+    vector<unique_ptr<Ring>> _rings;
+    std::atomic<uint64_t> _dropped{0};
+    FILE* _file;
+    std::mutex _mtx;
+    std::condition_variable _wake;
+    bool _stopping = false;
+    std::thread _flusher;
+
+    uint64_t elapsedNs() const;
+    void run();
+    void flush();
+};
+
+#endif //DICE_TRAJECTORYLOG_H
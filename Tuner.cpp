@@ -0,0 +1,147 @@
+#include "Tuner.h"
+#include "Die.h"
+#include "RestartScheduler.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+
+/**
+ * Create a tuner.  The search itself is seeded so repeated runs try the same candidates.
+ * @param settings
+ */
+Tuner::Tuner(const Settings& settings) : _settings(settings), _rng(12345) {
+}
+
+/**
+ * Tune every requested side count and save the presets
+ * @return process exit code
+ */
+int Tuner::run() {
+    vector<OptimizerParams> presets = OptimizerParams::loadPresets();
+
+    for (size_t sides: _settings.sides) {
+        double target = findTarget(sides);
+        cout << "D" << sides << " target stress=" << setprecision(15) << target << "\n";
+
+        //start from what we would have used and keep the fastest mutation
+        OptimizerParams best = OptimizerParams::forSides(sides);
+        best.sides = sides;
+        double bestScore = score(sides, best, target);
+        cout << "  candidate 0 " << setprecision(4) << bestScore << "s (current)\n";
+
+        for (unsigned int candidate = 1; candidate < _settings.candidates; ++candidate) {
+            OptimizerParams trial = mutate(best);
+            double trialScore = score(sides, trial, target);
+            cout << "  candidate " << candidate << " " << setprecision(4) << trialScore << "s"
+                 << " pick=" << trial.randomPickOdds << " window=" << trial.neighbourWindow
+                 << " start=" << trial.startRate << " reduce=" << trial.reduceRate
+                 << " restart=" << trial.restartTimeout << " anneal=" << trial.continuationSteps << "\n";
+            if (trialScore >= bestScore) continue;
+            bestScore = trialScore;
+            best = trial;
+        }
+
+        //replace any old preset for this side count
+        presets.erase(std::remove_if(presets.begin(), presets.end(),
+                                     [sides](const OptimizerParams& p) { return p.sides == sides; }),
+                      presets.end());
+        presets.push_back(best);
+        std::sort(presets.begin(), presets.end(),
+                  [](const OptimizerParams& a, const OptimizerParams& b) { return a.sides < b.sides; });
+        OptimizerParams::savePresets(presets);
+        OptimizerParams::setPresets(presets);
+        cout << "D" << sides << " best " << setprecision(4) << bestScore << "s saved to " << PRESET_FILE << "\n";
+    }
+    return 0;
+}
+
+/**
+ * Energy a run must reach to count as finished.  Uses the saved best if there is one, otherwise
+ * whatever a default run reaches in the time budget.
+ * @param sides
+ * @return
+ */
+double Tuner::findTarget(size_t sides) {
+    try {
+        PointSphere saved(sides);
+        saved.load();
+        return saved.getTotalStress() * (1 + _settings.tolerance);
+    } catch (...) {
+    }
+
+    cout << "D" << sides << " has no saved best, running reference optimization\n";
+    srand(1);
+    Die reference(sides, false, OptimizerParams(), 1);
+    auto start = std::chrono::steady_clock::now();
+    while (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() < _settings.runSeconds) {
+        for (int i = 0; i < 256; ++i) reference.optimize();
+    }
+    return reference.getBest().getTotalStress() * (1 + _settings.tolerance);
+}
+
+/**
+ * Run one seeded optimization, restarting like a worker thread would, until the target is reached
+ * @param sides
+ * @param params
+ * @param target
+ * @param seed
+ * @return seconds taken, or twice the budget if the target was never reached
+ */
+double Tuner::timeToTarget(size_t sides, const OptimizerParams& params, double target, unsigned int seed) {
+    srand(seed);
+    std::mt19937 dieSeeds(seed);        //restarted dies get their own seeds, still fixed by the trial seed
+    auto start = std::chrono::steady_clock::now();
+    auto die = std::make_unique<Die>(sides, false, params, dieSeeds());
+    RestartScheduler scheduler(sides, 1, params.restartTimeout);
+    scheduler.beginRun(0);
+    while (true) {
+        for (int i = 0; i < 256; ++i) die->optimize();
+
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (die->getBestStress() <= target) return elapsed;
+        if (elapsed > _settings.runSeconds) return 2 * _settings.runSeconds;
+        if (scheduler.shouldRestart(0, *die)) {
+            die = std::make_unique<Die>(sides, false, params, dieSeeds());
+            scheduler.beginRun(0);
+        }
+    }
+}
+
+/**
+ * Average time to target over the seeded runs
+ * @param sides
+ * @param params
+ * @param target
+ * @return
+ */
+double Tuner::score(size_t sides, const OptimizerParams& params, double target) {
+    double total = 0;
+    for (unsigned int seed = 1; seed <= _settings.seeds; ++seed) {
+        total += timeToTarget(sides, params, target, seed);
+    }
+    return total / _settings.seeds;
+}
+
+/**
+ * Randomly scale each parameter by up to 2x in either direction, keeping it in a sane range
+ * @param params
+ * @return
+ */
+OptimizerParams Tuner::mutate(const OptimizerParams& params) {
+    std::normal_distribution<double> step(0.0, 0.5);
+    auto scale = [this, &step](double value, double low, double high) {
+        return std::max(low, std::min(high, value * std::exp2(step(_rng))));
+    };
+
+    OptimizerParams result = params;
+    result.randomPickOdds = static_cast<unsigned int>(std::lround(scale(params.randomPickOdds, 2, 64)));
+    result.neighbourWindow = scale(params.neighbourWindow, 0.25, 4.0);
+    result.startRate = scale(params.startRate, 0.01, 1.0);
+    result.reduceRate = std::lround(scale(static_cast<double>(params.reduceRate), 2, 120));
+    result.restartTimeout = std::lround(scale(static_cast<double>(params.restartTimeout), 5, 600));
+    result.continuationSteps = static_cast<unsigned int>(std::lround(scale(std::max(1u, params.continuationSteps), 1, 200)));
+    return result;
+}
@@ -0,0 +1,37 @@
+#ifndef DICE_TUNER_H
+#define DICE_TUNER_H
+
+#include <vector>
+#include <random>
+#include "OptimizerParams.h"
+
+using namespace std;
+
+/**
+ * Searches OptimizerParams for the fastest time to reach the best known energy of each side count
+ * and writes the winners to PRESET_FILE.
+ */
+class Tuner {
+public:
+    struct Settings {
+        vector<size_t> sides;
+        unsigned int candidates = 24;   //parameter sets tried per side count
+        unsigned int seeds = 3;         //seeded runs averaged per parameter set
+        double runSeconds = 20;         //time budget for a single run
+        double tolerance = 1e-4;        //target energy is best known * (1 + tolerance)
+    };
+
+    explicit Tuner(const Settings& settings);
+    int run();
+
+private:
+    Settings _settings;
+    mt19937 _rng;
+
+    double findTarget(size_t sides);
+    double timeToTarget(size_t sides, const OptimizerParams& params, double target, unsigned int seed);
+    double score(size_t sides, const OptimizerParams& params, double target);
+    OptimizerParams mutate(const OptimizerParams& params);
+};
+
+#endif //DICE_TUNER_H
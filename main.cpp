@@ -1,16 +1,31 @@
 #include <iostream>
 #include <ctime>
+#include <csignal>
 #include <cmath>
 #include <thread>
-#include <array>
 #include <vector>
 #include <string>
 #include <atomic>
 #include <chrono>
+#include <filesystem>
+#include <algorithm>
 #include <iomanip>
 #include <limits>
+#include <memory>
 #include "Die.h"
+#include "BatchScheduler.h"
+#include "BestArchive.h"
+#include "CpuPlacement.h"
+#include "DieRegistry.h"
 #include "OptimizationThread.h"
+#include "PatchOptimizer.h"
+#include "RunControl.h"
+#include "RunState.h"
+#include "SaveWriter.h"
+#include "SharedDie.h"
+#include "ThreadPool.h"
+#include "TrajectoryLog.h"
+#include "Tuner.h"
 #include "qt/MainWindow.h"
 #include "qt/DieVisualization.h"
 #include <QApplication>
@@ -40,66 +55,312 @@ static QIcon createDiceIcon() {
     return QIcon(pm);
 }
 
+// One optimizer per core plus the best-polishing thread needs at least 2
+static size_t defaultThreadCount() {
+    return std::max<size_t>(2, std::thread::hardware_concurrency());
+}
+
+// Parses a side count list like "4,6,10-20" (ranges step by 2)
+static vector<size_t> parseSideCounts(const string& text) {
+    vector<size_t> result;
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t end = text.find(',', start);
+        if (end == string::npos) end = text.size();
+        string item = text.substr(start, end - start);
+        size_t dash = item.find('-');
+        if (dash == string::npos) {
+            result.push_back(stoul(item));
+        } else {
+            for (size_t n = stoul(item.substr(0, dash)); n <= stoul(item.substr(dash + 1)); n += 2)
+                result.push_back(n);
+        }
+        start = end + 1;
+    }
+    return result;
+}
+
+// Ctrl+C / SIGTERM ask the optimizer to stop so the best result is flushed before exit
+static RunControl* stopControl = nullptr;
+
+static void onStopSignal(int) {
+    if (stopControl) stopControl->requestStop();
+}
+
+static void installStopHandlers(RunControl& control) {
+    stopControl = &control;
+    std::signal(SIGINT, onStopSignal);
+    std::signal(SIGTERM, onStopSignal);
+}
+
 // ── Headless runner ───────────────────────────────────────────────────────────
 
-static int runHeadless(unsigned int sides, int timeLimit) {
+// How often the complete optimizer state is written to state/<sides>.state
+#define STATE_SECONDS 300
+
+// How long to wait for every thread to hand in its state before skipping that snapshot
+#define STATE_TIMEOUT_MS 5000
+
+// Best die as it was saved in the run state, or from best/ if there is none
+static Die* resumeBestDie(unsigned int sides, RunState& state, size_t slot) {
+    string saved = state.takeRestored(slot);
+    if (!saved.empty()) {
+        try {
+            RunState::Reader reader(saved);
+            return new Die(sides, reader);
+        } catch (const std::exception& e) {
+            cerr << "Polisher could not resume: " << e.what() << "\n";
+        }
+    }
+    return new Die(sides, true);
+}
+
+static void provideBestState(RunState& state, size_t slot, const Die& die) {
+    RunState::Writer writer;
+    die.writeState(writer);
+    state.provide(slot, writer.bytes());
+}
+
+static int runHeadless(unsigned int sides, int timeLimit, size_t threadCount,
+                       const MigrationHub::Settings& migrationSettings, bool resume, bool logTrajectory) {
     std::srand(std::time(0));
-    std::array<Die*, THREAD_COUNT> dieArray{nullptr,nullptr,nullptr,nullptr,nullptr};
-    dieArray[THREAD_COUNT-1] = new Die(sides, true);
+    DieRegistry dieRegistry;
+    dieRegistry.resize(threadCount);
+    const size_t bestSlot = dieRegistry.bestSlot();
+    RunState state(sides, threadCount);
+    if (resume && !state.load()) cout << "No saved state in " << RunState::filename(sides) << ", starting fresh\n";
+    std::unique_ptr<TrajectoryLog> log;
+    if (logTrajectory) log = std::make_unique<TrajectoryLog>(sides, threadCount, TrajectoryLog::defaultFilename(sides));
 
-    std::atomic<bool> running(true);
+    RunControl control;
+    installStopHandlers(control);
+    RestartScheduler scheduler(sides, threadCount - 1);
+    MigrationHub migration(threadCount - 1, migrationSettings);
+    std::thread bestThread([&]() {
+        //created on this thread so a pinned run allocates its points on this thread's node
+        CpuPlacement::instance().pinCurrentThread("Polisher", bestSlot);
+        Die* bestDie = resumeBestDie(sides, state, bestSlot);
+        bestDie->setPool(&ThreadPool::instance());
+        dieRegistry.replace(bestSlot, bestDie);
+        if (log) log->restart(bestSlot, *bestDie);
+        while (control.waitWhilePaused()) {
+            bestDie->optimize();
+            if (log) log->sample(bestSlot, *bestDie);
+            if (state.wanted(bestSlot)) provideBestState(state, bestSlot, *bestDie);
+        }
+        bestDie->flushNotifications();
+        provideBestState(state, bestSlot, *bestDie);
+    });
     std::vector<OptimizationThread*> optThreads;
-    for (size_t i = 0; i < THREAD_COUNT - 1; ++i) {
-        this_thread::sleep_for(chrono::milliseconds(200));
-        auto* t = new OptimizationThread(i, dieArray, sides, running);
+    for (size_t i = 0; i < threadCount - 1; ++i) {
+        if (!control.sleepFor(chrono::milliseconds(200))) break;
+        auto* t = new OptimizationThread(i, dieRegistry, sides, control, scheduler, migration, &state,
+                                         log.get());
         optThreads.push_back(t);
         t->start();
     }
-    std::thread bestThread([&]() {
-        while (running.load()) dieArray[THREAD_COUNT-1]->optimize();
-    });
     std::thread saveThread([&]() {
-        const int TICKS = 100; int tick = TICKS;
-        while (running.load()) {
-            this_thread::sleep_for(chrono::milliseconds(100));
-            if (--tick > 0) continue;
-            tick = TICKS;
-            size_t best = 0; double bestStress = numeric_limits<double>::max();
-            for (int i = 0; i < THREAD_COUNT; ++i)
-                if (dieArray[i] && dieArray[i]->getBest().getTotalStress() < bestStress) {
-                    bestStress = dieArray[i]->getBest().getTotalStress(); best = i; }
-            dieArray[best]->save();
-            double sec = dieArray[best]->getSecondsSinceLastBest();
-            cout << "D" << dieArray[best]->getBest().sideCount()
-                 << " " << sec << "s since best  stress="
-                 << setprecision(15) << bestStress << "\n";
+        uint64_t savedImprovements = 0;
+        auto nextStateTime = chrono::steady_clock::now() + chrono::seconds(STATE_SECONDS);
+        while (control.sleepFor(chrono::seconds(10))) {
+            if (chrono::steady_clock::now() >= nextStateTime) {
+                nextStateTime += chrono::seconds(STATE_SECONDS);
+                if (!state.save(chrono::milliseconds(STATE_TIMEOUT_MS))) cerr << "Run state not saved\n";
+            }
+
+            EpochGuard guard;
+            Die* best = dieRegistry.best();
+            if (best == nullptr) continue;
+
+            //only touch the disk when a die has reported something better since the last save
+            uint64_t improvements = dieRegistry.improvementCount();
+            if (improvements != savedImprovements) {
+                best->save();
+                savedImprovements = improvements;
+            }
+            double sec = best->getSecondsSinceLastBest();
+            cout << "D" << sides << " " << sec << "s since best  stress="
+                 << setprecision(15) << best->getBestStress() << "\n";
             if (timeLimit > 0 && sec >= timeLimit) {
                 cout << "Time limit reached.\n";
-                running.store(false); exit(0);
+                control.stop();
             }
         }
     });
     bestThread.join(); saveThread.join();
     for (auto* t : optThreads) { t->wait(); delete t; }
-    for (auto* d : dieArray)   delete d;
+
+    // Final flush once every thread has finished its last step
+    if (Die* best = dieRegistry.best()) best->save();
+    SaveWriter::instance().flush();
+    state.write();
+    if (log && log->dropped() > 0) cerr << log->dropped() << " trajectory records dropped\n";
+    dieRegistry.clear();
+    return 0;
+}
+
+// ── Speculative runner ────────────────────────────────────────────────────────
+
+static int runSpeculative(unsigned int sides, int timeLimit, size_t threadCount) {
+    std::srand(std::time(0));
+    SharedDie die(sides, true);
+    RunControl control;
+    installStopHandlers(control);
+
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < threadCount; ++i) {
+        workers.emplace_back([&die, &control, i]() {
+            CpuPlacement::instance().pinCurrentThread("Mover", i);
+            SharedDie::Worker worker(static_cast<unsigned int>(std::time(0) + i));
+            die.initWorker(worker);
+            while (control.waitWhilePaused()) die.optimize(worker);
+        });
+    }
+
+    uint64_t savedVersion = die.getVersion();
+    uint64_t lastCommits = 0, lastConflicts = 0;
+    while (control.sleepFor(chrono::seconds(10))) {
+        if (die.getVersion() != savedVersion) {
+            savedVersion = die.getVersion();
+            die.save();
+        }
+        uint64_t commits = die.getCommits(), conflicts = die.getConflicts();
+        double sec = die.getSecondsSinceLastBest();
+        cout << "D" << sides << " " << sec << "s since best  stress=" << setprecision(15) << die.getBestStress()
+             << "  " << (commits - lastCommits) / 10 << " moves/s  " << (conflicts - lastConflicts) / 10
+             << " conflicts/s\n";
+        lastCommits = commits;
+        lastConflicts = conflicts;
+        if (timeLimit > 0 && sec >= timeLimit) {
+            cout << "Time limit reached.\n";
+            control.stop();
+        }
+    }
+    for (auto& worker: workers) worker.join();
+
+    // Final flush once every thread has finished its last step
+    die.save();
+    SaveWriter::instance().flush();
     return 0;
 }
 
+// ── Patch runner ──────────────────────────────────────────────────────────────
+
+// Several patches per thread so uneven patches still keep every thread busy
+#define PATCHES_PER_THREAD 4
+
+static int runPatches(unsigned int sides, int timeLimit, size_t threadCount) {
+    std::srand(std::time(0));
+    PatchOptimizer optimizer(sides, true, threadCount, threadCount * PATCHES_PER_THREAD);
+    RunControl control;
+    installStopHandlers(control);
+
+    std::thread roundThread([&]() {
+        while (control.waitWhilePaused()) optimizer.round();
+    });
+
+    uint64_t savedVersion = optimizer.getVersion();
+    uint64_t lastRounds = 0;
+    while (control.sleepFor(chrono::seconds(10))) {
+        if (optimizer.getVersion() != savedVersion) {
+            savedVersion = optimizer.getVersion();
+            optimizer.save();
+        }
+        uint64_t rounds = optimizer.getRounds();
+        double sec = optimizer.getSecondsSinceLastBest();
+        cout << "D" << sides << " " << sec << "s since best  stress=" << setprecision(15)
+             << optimizer.getBestStress() << "  " << (rounds - lastRounds) << " rounds\n";
+        lastRounds = rounds;
+        if (timeLimit > 0 && sec >= timeLimit) {
+            cout << "Time limit reached.\n";
+            control.stop();
+        }
+    }
+    roundThread.join();
+
+    // Final flush once the last round has finished
+    optimizer.save();
+    SaveWriter::instance().flush();
+    return 0;
+}
+
+// ── Batch runner ──────────────────────────────────────────────────────────────
+
+static int runBatch(const vector<size_t>& sides, int timeLimit, size_t threadCount) {
+    std::srand(std::time(0));
+    RunControl control;
+    installStopHandlers(control);
+    return BatchScheduler(sides, threadCount, timeLimit, control).run();
+}
+
 // ── GUI runner ────────────────────────────────────────────────────────────────
 
 int main(int argc, char* argv[]) {
-    unsigned int sides     = 0;
+    vector<size_t> sides;
     int          timeLimit = -1;
+    size_t       threads   = defaultThreadCount();
     bool         headless  = false;
+    bool         speculative = false;
+    bool         patches   = false;
+    bool         pack      = false;
+    bool         resume    = false;
+    bool         logTrajectory = false;
+    string       logToConvert;
+    MigrationHub::Settings migrationSettings;
+    Tuner::Settings tune;
     for (int i = 1; i < argc; ++i) {
         string arg = argv[i];
-        if      (arg.find("-s=") == 0) { sides     = stoi(arg.substr(3)); headless = true; }
+        if      (arg.find("-s=") == 0) { sides     = parseSideCounts(arg.substr(3)); headless = true; }
         else if (arg.find("-t=") == 0) { timeLimit = stoi(arg.substr(3)); headless = true; }
+        else if (arg.find("-j=") == 0)   threads = std::max<size_t>(2, stoul(arg.substr(3)));
+        else if (arg == "-speculative")  speculative = true;
+        else if (arg == "-patches")      patches = true;
+        else if (arg.find("-reorder=") == 0)  OptimizerParams::overrideReorderSweeps(stoul(arg.substr(9)));
+        else if (arg == "-pack")         pack = true;
+        else if (arg == "-resume" || arg == "--resume") resume = true;
+        else if (arg == "-log")          logTrajectory = true;
+        else if (arg.find("-logcsv=") == 0)   logToConvert = arg.substr(8);
+        else if (arg == "-csv")          PointSphere::setCsvExport(true);
+        else if (arg == "-pin")          CpuPlacement::instance().setEnabled(true);
+        else if (arg.find("-migrate=") == 0)  migrationSettings.interval = stod(arg.substr(9));
+        else if (arg.find("-pressure=") == 0) migrationSettings.selectionPressure = stod(arg.substr(10));
+        else if (arg == "-topology=random")   migrationSettings.topology = MigrationHub::Topology::Random;
+        else if (arg == "-topology=ring")     migrationSettings.topology = MigrationHub::Topology::Ring;
+        else if (arg.find("-tune=") == 0)      tune.sides      = parseSideCounts(arg.substr(6));
+        else if (arg.find("-tunecand=") == 0)  tune.candidates = stoi(arg.substr(10));
+        else if (arg.find("-tuneseeds=") == 0) tune.seeds      = stoi(arg.substr(11));
+        else if (arg.find("-tunetime=") == 0)  tune.runSeconds = stod(arg.substr(10));
+    }
+    if (pack) {
+        size_t packed = BestArchive::build("best");
+        cout << "Packed " << packed << " side counts into " << ARCHIVE_FILE << "\n";
+        return packed > 0 ? 0 : 1;
+    }
+    if (!logToConvert.empty()) {
+        string csvFile = std::filesystem::path(logToConvert).replace_extension(".csv").string();
+        if (!TrajectoryLog::toCsv(logToConvert, csvFile)) return 1;
+        cout << "Wrote " << csvFile << "\n";
+        return 0;
+    }
+    if (!tune.sides.empty()) {
+        for (size_t n : tune.sides)
+            if (n < 4 || n % 2 == 1) { cerr << "Tuner side counts must be even and at least 4\n"; return 1; }
+        return Tuner(tune).run();
     }
     if (headless) {
-        if (sides == 0) { cerr << "Headless mode requires -s=<sides>\n"; return 1; }
-        return runHeadless(sides, timeLimit);
+        if (sides.empty()) { cerr << "Headless mode requires -s=<sides>\n"; return 1; }
+        for (size_t n : sides)
+            if (n < 2 || n % 2 == 1) { cerr << "Side counts must be even\n"; return 1; }
+        if (logTrajectory && (sides.size() > 1 || speculative || patches)) {
+            cerr << "-log only works for a single side count without -speculative or -patches\n";
+            return 1;
+        }
+        if (sides.size() > 1) return runBatch(sides, timeLimit, threads);
+        if (speculative) return runSpeculative(sides[0], timeLimit, threads);
+        if (patches) return runPatches(sides[0], timeLimit, threads);
+        return runHeadless(sides[0], timeLimit, threads, migrationSettings, resume, logTrajectory);
     }
+    if (logTrajectory) { cerr << "-log only works in headless mode\n"; return 1; }
 
     std::srand(std::time(0));
     QApplication app(argc, argv);
@@ -111,50 +372,56 @@ int main(int argc, char* argv[]) {
     QDir::setCurrent(QCoreApplication::applicationDirPath());
 #endif
 
-    // dieArray lives here for the whole session.
-    // DieVisualization holds a reference to it and polls every 50 ms.
+    // dieRegistry lives here for the whole session.
+    // DieVisualization holds a reference to it, repaints when a registry listener reports a new best
+    // and falls back to a 1 s timer.
     // Optimization threads write into it after Start is clicked.
-    std::array<Die*, THREAD_COUNT> dieArray{nullptr,nullptr,nullptr,nullptr,nullptr};
+    DieRegistry dieRegistry;
 
-    MainWindow window(dieArray);
+    RunControl control;
+    MainWindow window(dieRegistry, control, threads);
     window.resize(800, 600);
     window.show();
 
     // Optimization state — created on Start, cleaned up on quit.
-    std::atomic<bool>              running{false};
+    bool                           started = false;
+    std::unique_ptr<RestartScheduler> scheduler;
+    std::unique_ptr<MigrationHub>     migration;
     std::vector<OptimizationThread*> optThreads;
     std::thread bestThread;
     std::thread saveThread;
 
     QObject::connect(&window, &MainWindow::startRequested,
-                     [&](unsigned int sides) {
+                     [&](unsigned int sides, unsigned int threadCount) {
         try {
-            dieArray[THREAD_COUNT-1] = new Die(sides, true);
-            running.store(true);
+            dieRegistry.resize(threadCount);
+            const size_t bestSlot = dieRegistry.bestSlot();
+            started = true;
+            scheduler = std::make_unique<RestartScheduler>(sides, threadCount - 1);
+            migration = std::make_unique<MigrationHub>(threadCount - 1, migrationSettings);
 
-            for (size_t i = 0; i < THREAD_COUNT - 1; ++i) {
-                auto* t = new OptimizationThread(i, dieArray, sides, running);
+            for (size_t i = 0; i < threadCount - 1; ++i) {
+                auto* t = new OptimizationThread(i, dieRegistry, sides, control, *scheduler, *migration);
                 optThreads.push_back(t);
                 t->start();
             }
-            bestThread = std::thread([&]() {
-                while (running.load() && dieArray[THREAD_COUNT-1])
-                    dieArray[THREAD_COUNT-1]->optimize();
+            bestThread = std::thread([&dieRegistry, &control, bestSlot, sides]() {
+                //created on this thread so a pinned run allocates its points on this thread's node
+                CpuPlacement::instance().pinCurrentThread("Polisher", bestSlot);
+                Die* bestDie = new Die(sides, true);
+                bestDie->setPool(&ThreadPool::instance());
+                dieRegistry.replace(bestSlot, bestDie);
+                while (control.waitWhilePaused()) bestDie->optimize();
+                bestDie->flushNotifications();
             });
             saveThread = std::thread([&]() {
-                const int TICKS = 100; int tick = TICKS;
-                while (running.load()) {
-                    this_thread::sleep_for(chrono::milliseconds(100));
-                    if (--tick > 0) continue;
-                    tick = TICKS;
-                    size_t best = 0; double bestStress = numeric_limits<double>::max();
-                    for (int i = 0; i < THREAD_COUNT; ++i)
-                        if (dieArray[i] &&
-                            dieArray[i]->getBest().getTotalStress() < bestStress) {
-                            bestStress = dieArray[i]->getBest().getTotalStress();
-                            best = i;
-                        }
-                    dieArray[best]->save();
+                uint64_t savedImprovements = 0;
+                while (control.sleepFor(chrono::seconds(10))) {
+                    uint64_t improvements = dieRegistry.improvementCount();
+                    if (improvements == savedImprovements) continue;
+                    EpochGuard guard;
+                    if (Die* best = dieRegistry.best()) best->save();
+                    savedImprovements = improvements;
                 }
             });
         } catch (const std::exception& e) {
@@ -166,23 +433,19 @@ int main(int argc, char* argv[]) {
     });
 
     QObject::connect(&app, &QApplication::aboutToQuit, [&]() {
-        if (!running.load()) return;
+        if (!started) return;
 
-        // Save best result
-        size_t best = 0; double bestStress = numeric_limits<double>::max();
-        for (int i = 0; i < THREAD_COUNT; ++i)
-            if (dieArray[i] &&
-                dieArray[i]->getBest().getTotalStress() < bestStress) {
-                bestStress = dieArray[i]->getBest().getTotalStress(); best = i; }
-        if (dieArray[best]) dieArray[best]->save();
-
-        running.store(false);
+        control.stop();
         for (auto* t : optThreads) t->wait();
         if (bestThread.joinable()) bestThread.join();
         if (saveThread.joinable()) saveThread.join();
 
+        // Save best result once nothing is changing it
+        if (Die* best = dieRegistry.best()) best->save();
+        SaveWriter::instance().flush();
+
         for (auto* t : optThreads) delete t;
-        for (auto* d : dieArray)   delete d;
+        dieRegistry.clear();
     });
 
     return app.exec();
@@ -6,16 +6,26 @@
 #include <QMessageBox>
 #include "stl/STL.h"
 
-DieVisualization::DieVisualization(std::array<Die*, THREAD_COUNT>& dieArray, QWidget* parent)
-        : QWidget(parent), _dieArray(dieArray), _pointsWindow(nullptr), _highlightExtremes(true) {
+DieVisualization::DieVisualization(DieRegistry& dieRegistry, RunControl& control, QWidget* parent)
+        : QWidget(parent), _dieRegistry(dieRegistry), _control(control), _pointsWindow(nullptr), _highlightExtremes(true) {
     setMinimumSize(744, 328);
     resize(744, 328);
 
     setSizePolicy(QSizePolicy::Preferred, QSizePolicy::Preferred);
 
+    // Repaint when a die finds a better configuration, the dies rate limit how often that happens
+    _listenerId = _dieRegistry.subscribe([this](double, uint64_t) {
+        QMetaObject::invokeMethod(this, [this]() { update(); }, Qt::QueuedConnection);
+    });
+
+    // Slow tick keeps the time since last best counting up
     _timer = new QTimer(this);
     connect(_timer, &QTimer::timeout, this, &DieVisualization::updateVisualization);
-    _timer->start(50); // Update every 50 ms
+    _timer->start(1000);
+}
+
+DieVisualization::~DieVisualization() {
+    _dieRegistry.unsubscribe(_listenerId);
 }
 
 void DieVisualization::updateVisualization() {
@@ -26,24 +36,15 @@ void DieVisualization::paintEvent(QPaintEvent* event) {
     QPainter painter(this);
     painter.fillRect(rect(), Qt::white);
 
-    _bestMutex.lock();
+    // Keeps the dies alive while we draw, an optimizer replacing one never waits for us
+    EpochGuard guard;
 
     // Find the current best die
-    size_t bestIndex = 0;
-    double bestStress = std::numeric_limits<double>::max();
-    for (int i = 0; i < THREAD_COUNT; ++i) {
-        if (_dieArray[i] != nullptr) {
-            double stress = _dieArray[i]->getBest().getTotalStress();
-            if (stress < bestStress) {
-                bestStress = stress;
-                bestIndex = i;
-            }
-        }
-    }
+    size_t bestIndex = _dieRegistry.bestIndex();
+    Die* bestDie = (bestIndex < _dieRegistry.size()) ? _dieRegistry.get(bestIndex) : nullptr;
 
     // Show placeholder until optimization has started
-    if (bestStress == std::numeric_limits<double>::max()) {
-        _bestMutex.unlock();
+    if (bestDie == nullptr) {
         painter.setPen(Qt::gray);
         painter.setFont(QFont("Arial", 14));
         painter.drawText(rect(), Qt::AlignCenter,
@@ -51,6 +52,8 @@ void DieVisualization::paintEvent(QPaintEvent* event) {
         return;
     }
 
+    double bestStress = bestDie->getBestStress();
+
     // Set up painter and font
     painter.setPen(Qt::black);
     painter.setFont(QFont("Arial", 16));
@@ -71,8 +74,8 @@ void DieVisualization::paintEvent(QPaintEvent* event) {
     painter.drawText(stressTextX, threadTextY, stressText);
 
     // Display time since last (Right-aligned)
-    QString lastBestText = QString("Last Best: %1s").arg(_dieArray[bestIndex]->getSecondsSinceLastBest());
-    if (Die::isOptimizationPaused()) lastBestText = QString("Optimization Paused");
+    QString lastBestText = QString("Last Best: %1s").arg(bestDie->getSecondsSinceLastBest());
+    if (_control.isPaused()) lastBestText = QString("Optimization Paused");
     int lastBestTextWidth = fm.horizontalAdvance(lastBestText);
     int lastBestTextX = widgetWidth - lastBestTextWidth - 10; // 10 pixels from right edge
     painter.drawText(lastBestTextX, threadTextY, lastBestText);
@@ -88,11 +91,7 @@ void DieVisualization::paintEvent(QPaintEvent* event) {
     painter.drawText(contributionTextX, contributionTextY, contributionText);
 
     // Draw the die (consider checkbox value for highlighting extremes)
-    if (_dieArray[bestIndex] != nullptr) {
-        _dieArray[bestIndex]->draw(painter, _highlightExtremes);
-    }
-
-    _bestMutex.unlock();
+    bestDie->draw(painter, _highlightExtremes);
 }
 
 void DieVisualization::resizeEvent(QResizeEvent* event) {
@@ -109,40 +108,32 @@ void DieVisualization::resizeEvent(QResizeEvent* event) {
 void DieVisualization::togglePoints() {
     if (_pointsWindow && _pointsWindow->isVisible()) {
         _pointsWindow->close();
-        Die::resumeOptimization();
+        _control.resume();
         emit pointsWindowToggled(false);
     } else {
         if (!_pointsWindow) {
-            _pointsWindow = new PointsWindow(20.0, _dieArray, this);
+            _pointsWindow = new PointsWindow(20.0, _dieRegistry, this);
             _pointsWindow->setAttribute(Qt::WA_DeleteOnClose);
             connect(_pointsWindow, &QWidget::destroyed, this, [this]() {
                 _pointsWindow = nullptr;
-                Die::resumeOptimization();
+                _control.resume();
                 emit pointsWindowToggled(false);
             });
         }
         _pointsWindow->show();
-        Die::pauseOptimization();
+        _control.pause();
         emit pointsWindowToggled(true);
     }
+    update();
 }
 
 void DieVisualization::setHighlightExtremes(bool highlight) {
     _highlightExtremes = highlight;
+    update();
 }
 
 void DieVisualization::buildModel() {
-    size_t bestIndex = 0;
-    double bestStress = std::numeric_limits<double>::max();
-    for (int i = 0; i < THREAD_COUNT; ++i) {
-        if (_dieArray[i] != nullptr) {
-            double stress = _dieArray[i]->getBest().getTotalStress();
-            if (stress < bestStress) {
-                bestStress = stress;
-                bestIndex = i;
-            }
-        }
-    }
+    if (_dieRegistry.best() == nullptr) return;
 
     BuildModelDialog dlg(this);
     if (dlg.exec() != QDialog::Accepted) return;
@@ -150,12 +141,19 @@ void DieVisualization::buildModel() {
     // Scale to physical mm so engraveDepth (mm) is meaningful.
     const double cloudRadius = 20.0;
     std::vector<Vec3> points;
-    for (size_t i = 0; i < _dieArray[bestIndex]->getBest().sideCount(); ++i) {
-        Vec3 point = _dieArray[bestIndex]->getBest().getPoint(i) * cloudRadius;
-        points.push_back(point);
+    std::vector<size_t> labels;
+    {
+        EpochGuard guard;
+        Die* bestDie = _dieRegistry.best();
+        if (bestDie == nullptr) return;
+        PointSphere best = bestDie->getBest();
+        for (size_t i = 0; i < best.sideCount(); ++i) {
+            Vec3 point = best.getPoint(i) * cloudRadius;
+            points.push_back(point);
+        }
+        labels = bestDie->getLabels(best);
     }
     double radius = computeMaxRadius(points);
-    std::vector<size_t> labels = _dieArray[bestIndex]->getLabels();
     auto font = dlg.selectedFont();
     int limit = font->maxSides();
     if (limit > 0 && (int)labels.size() > limit) {
@@ -3,16 +3,16 @@
 #define DIEVISUALIZATION_H
 
 #include <QWidget>
-#include <array>
-#include <QMutex>
 #include "Die.h"
-#include "OptimizationThread.h"
+#include "DieRegistry.h"
+#include "RunControl.h"
 #include "PointsWindow.h"
 
 class DieVisualization : public QWidget {
 Q_OBJECT
 public:
-    explicit DieVisualization(std::array<Die*, THREAD_COUNT>& dieArray, QWidget* parent = nullptr);
+    explicit DieVisualization(DieRegistry& dieRegistry, RunControl& control, QWidget* parent = nullptr);
+    ~DieVisualization() override;
 
 signals:
     void pointsWindowToggled(bool showing);
@@ -32,9 +32,10 @@ private slots:
     void updateVisualization();
 
 private:
-    std::array<Die*, THREAD_COUNT>& _dieArray;
-    QMutex _bestMutex;
+    DieRegistry& _dieRegistry;
+    RunControl& _control;
     QTimer* _timer;
+    size_t _listenerId;
     PointsWindow* _pointsWindow;
     bool _highlightExtremes;
 };
@@ -6,7 +6,7 @@
 #include <QIntValidator>
 #include <QCheckBox>
 
-MainWindow::MainWindow(std::array<Die*, THREAD_COUNT>& dieArray, QWidget* parent)
+MainWindow::MainWindow(DieRegistry& dieRegistry, RunControl& control, size_t defaultThreads, QWidget* parent)
     : QWidget(parent)
 {
     setWindowTitle("Dice Optimizer");
@@ -32,6 +32,12 @@ MainWindow::MainWindow(std::array<Die*, THREAD_COUNT>& dieArray, QWidget* parent
     _sideCountInput->setPlaceholderText("even #");
     inputLayout->addWidget(_sideCountInput);
 
+    inputLayout->addWidget(new QLabel("Threads:"));
+    _threadCountInput = new QSpinBox();
+    _threadCountInput->setRange(2, 1024);   // one optimizer plus the best-polishing thread at minimum
+    _threadCountInput->setValue(static_cast<int>(defaultThreads));
+    inputLayout->addWidget(_threadCountInput);
+
     _startButton = new QPushButton("Start");
     _startButton->setEnabled(false);
     inputLayout->addWidget(_startButton);
@@ -39,7 +45,7 @@ MainWindow::MainWindow(std::array<Die*, THREAD_COUNT>& dieArray, QWidget* parent
     root->addWidget(_inputBar);
 
     // ── Visualization (always present, shows placeholder until started) ───────
-    _vis = new DieVisualization(dieArray, this);
+    _vis = new DieVisualization(dieRegistry, control, this);
     root->addWidget(_vis, 1);
 
     // ── Bottom bar ────────────────────────────────────────────────────────────
@@ -101,5 +107,5 @@ void MainWindow::onStartButtonClicked() {
     _inputBar->setEnabled(false);
     _pointsButton->setEnabled(true);
 
-    emit startRequested(sides);
+    emit startRequested(sides, static_cast<unsigned int>(_threadCountInput->value()));
 }
@@ -3,20 +3,21 @@
 #include <QLineEdit>
 #include <QPushButton>
 #include <QCheckBox>
-#include <array>
+#include <QSpinBox>
 #include "Die.h"
-#include "OptimizationThread.h"
+#include "DieRegistry.h"
+#include "RunControl.h"
 
 class DieVisualization;
 
 class MainWindow : public QWidget {
     Q_OBJECT
 public:
-    explicit MainWindow(std::array<Die*, THREAD_COUNT>& dieArray,
+    explicit MainWindow(DieRegistry& dieRegistry, RunControl& control, size_t defaultThreads,
                         QWidget* parent = nullptr);
 
 signals:
-    void startRequested(unsigned int sides);
+    void startRequested(unsigned int sides, unsigned int threads);
 
 private slots:
     void onStartButtonClicked();
@@ -25,6 +26,7 @@ private slots:
 private:
     QWidget*          _inputBar;
     QLineEdit*        _sideCountInput;
+    QSpinBox*         _threadCountInput;
     QPushButton*      _startButton;
     DieVisualization* _vis;
     QPushButton*      _pointsButton;
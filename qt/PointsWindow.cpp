@@ -5,21 +5,18 @@
 
 
 // PointsWindow.cpp
-PointsWindow::PointsWindow(double radius, std::array<Die*, THREAD_COUNT>& dieArray, QWidget* parent)
+PointsWindow::PointsWindow(double radius, DieRegistry& dieRegistry, QWidget* parent)
         : QWidget(parent) {
-    //Compute Best
-    size_t bestIndex = 0;
-    double bestStress = std::numeric_limits<double>::max();
-    for (int i = 0; i < THREAD_COUNT; ++i) {
-        if (dieArray[i] != nullptr) {
-            double stress = dieArray[i]->getBest().getTotalStress();
-            if (stress < bestStress) {
-                bestStress = stress;
-                bestIndex = i;
-            }
+    //Copy the best die so the window never holds a pointer the optimizer may replace
+    {
+        EpochGuard guard;
+        Die* bestDie = dieRegistry.best();
+        if (bestDie != nullptr) {
+            PointSphere best = bestDie->getBest();
+            for (size_t i = 0; i < best.sideCount(); ++i) _points.push_back(best.getPoint(i));
+            _labels = bestDie->getLabels(best);
         }
     }
-    _bestDie = dieArray[bestIndex];
 
 
     // Create the radius input
@@ -89,10 +86,7 @@ void PointsWindow::updateRadiusRange() {
 double PointsWindow::maxRadius() const {
     double cloudRadius = _faceToCenterSpinBox->value();
     std::vector<Vec3> points;
-    for (size_t i = 0; i < _bestDie->getBest().sideCount(); ++i) {
-        Vec3 point = _bestDie->getBest().getPoint(i) * cloudRadius;
-        points.push_back(point);
-    }
+    for (const auto& point: _points) points.push_back(point * cloudRadius);
     return computeMaxRadius(points);
 }
 
@@ -103,15 +97,14 @@ void PointsWindow::populateTable() {
     _pointsTable->setRowCount(0);
 
     // Populate the table with points data
-    auto labels = _bestDie->getLabels();
-    for (size_t i = 0; i < _bestDie->getBest().sideCount(); ++i) {
-        const auto& point = _bestDie->getBest().getPoint(i);
+    for (size_t i = 0; i < _points.size(); ++i) {
+        const auto& point = _points[i];
 
         int row = _pointsTable->rowCount();
         _pointsTable->insertRow(row);
 
         //label
-        QTableWidgetItem* lItem = new QTableWidgetItem(QString::number(labels[i], 10));
+        QTableWidgetItem* lItem = new QTableWidgetItem(QString::number(_labels[i], 10));
         _pointsTable->setItem(row, 0, lItem);
 
         // X coordinate
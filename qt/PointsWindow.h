@@ -6,14 +6,13 @@
 #include <QTableWidget>
 #include <QDoubleSpinBox>
 #include <QVBoxLayout>
-#include <array>
 #include "Die.h"
-#include "OptimizationThread.h"
+#include "DieRegistry.h"
 
 class PointsWindow : public QWidget {
 Q_OBJECT
 public:
-    PointsWindow(double radius, std::array<Die*, THREAD_COUNT>& dieArray, QWidget* parent = nullptr);
+    PointsWindow(double radius, DieRegistry& dieRegistry, QWidget* parent = nullptr);
 
 public slots:
     void updateTable();
@@ -22,7 +21,8 @@ private:
     QDoubleSpinBox* _faceToCenterSpinBox;
     QDoubleSpinBox* _radiusDoubleBox;
     QTableWidget* _pointsTable;
-    Die* _bestDie;
+    vector<Vec3> _points;       //copy of the best die when the window opened
+    vector<size_t> _labels;
     double maxRadius() const;
     void updateRadiusRange();
 
@@ -2,117 +2,474 @@
 #include "Common.h"
 #include <cmath>
 #include <algorithm>
-#include <unordered_set>
-#include <array>
-
-static void clipPolygonWithPlane(const std::vector<Vec3>& polygon, const Plane& plane,
-                                  std::vector<Vec3>& out, std::vector<Vec3>& intersections) {
-    out.clear();
-    size_t n = polygon.size();
-    for (size_t i = 0; i < n; ++i) {
-        const Vec3& cur  = polygon[i];
-        const Vec3& prev = polygon[(i + n - 1) % n];
-        double cd = plane.distance(cur), pd = plane.distance(prev);
-        bool ci = cd <= 0, pi = pd <= 0;
-        if (ci) {
-            if (!pi) { Vec3 p = plane.intersect(prev, cur); out.push_back(p); intersections.push_back(p); }
-            out.push_back(cur);
-        } else if (pi) {
-            Vec3 p = plane.intersect(prev, cur); out.push_back(p); intersections.push_back(p);
+#include <limits>
+
+// Largest angle (radians, seen from the sphere centre) between neighbouring
+// points on arcs, edges and the rows of the sphere caps.
+static const double ARC_STEP = M_PI / 90;
+
+// Half-size of a cube around every die, in sphere radii.  Its planes only cut dice whose own
+// planes do not close (D4); the sphere beyond them is meshed too so the result stays closed.
+static const double BOUND_SIZE = 100.0;
+
+// Half-size of the square each face polygon is cut from, in sphere radii.  Bigger than the
+// bounding cube so the cube or the die's own planes always end a face, never the square.
+static const double START_SIZE = 2 * BOUND_SIZE;
+
+// Vertices closer than this (in sphere radii) are the same vertex.
+static const double WELD_TOLERANCE = 1e-9;
+
+namespace {
+
+// Polygon vertex followed by the edge lying on plane `plane` (-1 for the start square).
+struct Corner {
+    Vec3 point;
+    int plane;
+};
+
+// Point on a face boundary walk.
+struct BoundaryPoint {
+    Vec3 point;
+    bool outside;       // beyond the sphere
+    bool crossing;      // on the sphere, where the boundary enters or leaves it
+};
+
+// Point of a mesh row and its angle around the face centre, counted from the row start.
+struct RowPoint {
+    double angle;
+    Vec3 point;
+};
+
+// Common point of three planes, computed the same way whatever order they come in.
+Vec3 meet(const std::vector<Plane>& planes, int a, int b, int c) {
+    int ids[3] = {a, b, c};
+    std::sort(ids, ids + 3);
+    const Plane& p1 = planes[ids[0]];
+    const Plane& p2 = planes[ids[1]];
+    const Plane& p3 = planes[ids[2]];
+    Vec3 c23 = p2._normal.cross(p3._normal);
+    double det = p1._normal.dot(c23);
+    return (c23 * p1._d + p3._normal.cross(p1._normal) * p2._d + p1._normal.cross(p2._normal) * p3._d) / det;
+}
+
+// Cut face i's plane down to its polygon.  Planes are tried nearest first and the
+// rest skipped once none of them can reach the polygon any more.
+std::vector<Corner> facePolygon(size_t i, const std::vector<Plane>& planes, double r, double minD) {
+    const Plane& own = planes[i];
+    Vec3 n = own._normal, c = n * own._d;
+    Vec3 u = std::fabs(n.x) > 1e-6 || std::fabs(n.y) > 1e-6 ? Vec3(-n.y, n.x, 0.0) : Vec3(1.0, 0.0, 0.0);
+    u.normalize();
+    Vec3 v = n.cross(u);
+
+    double h = START_SIZE * r;
+    std::vector<Corner> polygon = {{c + (u - v) * h, -1}, {c + (u + v) * h, -1},
+                                   {c + (v - u) * h, -1}, {c - (u + v) * h, -1}};
+
+    std::vector<std::pair<double, int>> order;
+    order.reserve(planes.size());
+    for (size_t j = 0; j < planes.size(); ++j) {
+        if (j == i) continue;
+        double dot = std::max(-1.0, std::min(1.0, n.dot(planes[j]._normal)));
+        if (dot > 1 - 1e-15) continue;      // same plane direction, nothing to cut
+        order.emplace_back(std::acos(dot), (int)j);
+    }
+    std::sort(order.begin(), order.end());
+
+    std::vector<Corner> clipped;
+    double reach = M_PI;
+    for (const auto& candidate : order) {
+        if (candidate.first >= reach) break;
+        const Plane& cut = planes[candidate.second];
+        clipped.clear();
+        size_t count = polygon.size();
+        for (size_t k = 0; k < count; ++k) {
+            const Corner& p = polygon[k];
+            const Corner& q = polygon[(k + 1) % count];
+            double dp = cut.distance(p.point), dq = cut.distance(q.point);
+            bool pIn = dp <= 0, qIn = dq <= 0;
+            if (pIn) clipped.push_back(p);
+            if (pIn != qIn) clipped.push_back({cut.intersect(p.point, q.point), pIn ? candidate.second : p.plane});
+        }
+        polygon.swap(clipped);
+        if (polygon.size() < 3) return {};
+
+        // Plane j can only cut if some vertex v has n_j.v > d_j, bounded by |v| cos(angle(n, n_j) - angle(n, v)).
+        double farthest = 0, widest = 0;
+        for (const Corner& corner : polygon) {
+            double length = corner.point.length();
+            farthest = std::max(farthest, length);
+            widest = std::max(widest, std::acos(std::min(1.0, own._d / length)));
         }
+        reach = widest + std::acos(std::min(1.0, minD / farthest));
+    }
+
+    // Recompute vertices between two neighbouring planes exactly, so both faces get the same numbers.
+    for (size_t k = 0; k < polygon.size(); ++k) {
+        int before = polygon[(k + polygon.size() - 1) % polygon.size()].plane, after = polygon[k].plane;
+        if (before >= 0 && after >= 0 && before != after)
+            polygon[k].point = meet(planes, (int)i, before, after);
     }
+    return polygon;
 }
 
-void buildDieSphere(double r, const std::vector<Vec3>& points,
-                    std::vector<FaceData>& faces)
-{
-    const int latDiv = 100, lonDiv = 100;
-
-    // Sphere vertices
-    std::vector<Vec3> vertices;
-    vertices.reserve((latDiv+1)*(lonDiv+1));
-    for (int i = 0; i <= latDiv; ++i) {
-        double theta = i * M_PI / latDiv;
-        for (int j = 0; j <= lonDiv; ++j) {
-            double phi = j * 2 * M_PI / lonDiv;
-            vertices.push_back(Vec3(r * sin(theta)*cos(phi),
-                                    r * sin(theta)*sin(phi),
-                                    r * cos(theta)));
+// Replace vertices that several faces computed slightly differently with one shared value,
+// then drop the edges that collapsed.
+void weldPolygons(std::vector<std::vector<Corner>>& polygons, double tolerance) {
+    std::vector<Corner*> all;
+    for (auto& polygon : polygons)
+        for (auto& corner : polygon) all.push_back(&corner);
+    std::sort(all.begin(), all.end(), [](const Corner* a, const Corner* b) { return a->point < b->point; });
+
+    std::vector<Vec3> shared;       // in increasing x, as the corners are sorted
+    for (Corner* corner : all) {
+        bool snapped = false;
+        for (size_t s = shared.size(); s-- > 0 && corner->point.x - shared[s].x <= tolerance;) {
+            if (corner->point.distance(shared[s]) <= tolerance) {
+                corner->point = shared[s];
+                snapped = true;
+                break;
+            }
         }
+        if (!snapped) shared.push_back(corner->point);
+    }
+
+    for (auto& polygon : polygons) {
+        std::vector<Corner> kept;
+        for (size_t k = 0; k < polygon.size(); ++k)
+            if (!(polygon[k].point == polygon[(k + 1) % polygon.size()].point)) kept.push_back(polygon[k]);
+        polygon = kept.size() >= 3 ? kept : std::vector<Corner>();
     }
+}
+
+// Points strictly between a and b splitting the segment into steps of at most ARC_STEP.
+// Always computed from the smaller end so the faces on both sides get identical points.
+std::vector<Vec3> splitSegment(const Vec3& a, const Vec3& b) {
+    bool flipped = b < a;
+    const Vec3& from = flipped ? b : a;
+    const Vec3& to = flipped ? a : b;
+    double angle = std::atan2(from.cross(to).length(), from.dot(to));
+    size_t pieces = std::max<size_t>(1, (size_t)std::ceil(angle / ARC_STEP));
+    std::vector<Vec3> points;
+    for (size_t k = 1; k < pieces; ++k) points.push_back(from + (to - from) * ((double)k / pieces));
+    if (flipped) std::reverse(points.begin(), points.end());
+    return points;
+}
+
+// Where segment p-q passes through the sphere, in order from p.  Computed from the
+// smaller end so both faces sharing the edge get identical points.
+std::vector<Vec3> sphereCrossings(const Vec3& p, const Vec3& q, double r) {
+    bool pOut = p.lengthSquared() > r * r, qOut = q.lengthSquared() > r * r;
+    if (!pOut && !qOut) return {};
+    bool flipped = q < p;
+    const Vec3& from = flipped ? q : p;
+    const Vec3& to = flipped ? p : q;
+    Vec3 step = to - from;
+    double a = step.lengthSquared(), b = 2 * from.dot(step), c = from.lengthSquared() - r * r;
+    double disc = b * b - 4 * a * c;
+    double root = std::sqrt(std::max(0.0, disc));
+    double t1 = (-b - root) / (2 * a), t2 = (-b + root) / (2 * a);
+
+    std::vector<Vec3> points;
+    if (pOut != qOut) {
+        // one end inside: leaving it at the far root, entering at the near one
+        bool fromOut = flipped ? qOut : pOut;
+        double t = std::max(0.0, std::min(1.0, fromOut ? t1 : t2));
+        points.push_back(from + step * t);
+    } else {
+        // both ends outside: the edge may dip into the sphere, or just touch it, which pinches
+        // the cap there.  computeMaxRadius sizes the sphere to touch the closest pair's edge.
+        double nearest = -b / (2 * a);
+        if (nearest <= 0 || nearest >= 1) return {};
+        Vec3 closest = from + step * nearest;
+        if (closest.length() > r * (1 + WELD_TOLERANCE)) return {};
+        bool touching = closest.length() >= r * (1 - WELD_TOLERANCE);
+        points.push_back(touching ? closest : from + step * t1);
+        points.push_back(touching ? closest : from + step * t2);
+    }
+    if (flipped) std::reverse(points.begin(), points.end());
+    return points;
+}
 
-    // Sphere face indices
-    std::vector<std::array<int,3>> sphereFaces;
-    sphereFaces.reserve(latDiv * lonDiv * 2);
-    for (int i = 0; i < latDiv; ++i)
-        for (int j = 0; j < lonDiv; ++j) {
-            int f = i*(lonDiv+1)+j, s = f+lonDiv+1;
-            sphereFaces.push_back({f, s, f+1});
-            sphereFaces.push_back({s, s+1, f+1});
+// Store a cap triangle, skipping collapsed ones.  The strips are stitched so
+// the winding already faces away from the sphere centre.
+void storeCapTriangle(const Vec3& a, const Vec3& b, const Vec3& c) {
+    if (a == b || b == c || a == c) return;
+    Vec3 normal = (b - a).cross(c - a);
+    double length = normal.length();
+    if (length == 0) return;
+    storeTriangle(normal / length, a, b, c);
+}
+
+// Triangulate the strip between two rows running the same way round the face centre.
+void stitchRows(const std::vector<RowPoint>& inner, const std::vector<RowPoint>& outer) {
+    size_t i = 0, j = 0;
+    while (i + 1 < inner.size() || j + 1 < outer.size()) {
+        if (j + 1 == outer.size() || (i + 1 < inner.size() && inner[i + 1].angle <= outer[j + 1].angle)) {
+            storeCapTriangle(inner[i].point, outer[j].point, inner[i + 1].point);
+            ++i;
+        } else {
+            storeCapTriangle(inner[i].point, outer[j].point, outer[j + 1].point);
+            ++j;
         }
+    }
+}
+
+// Sphere beyond a face of the bounding cube: the polygon boundary, split the same way as the
+// neighbouring caps' edges, projected onto the sphere and filled in rings towards the middle.
+void meshBoundCap(const std::vector<Corner>& polygon, double r) {
+    std::vector<Vec3> ring;
+    for (size_t k = 0; k < polygon.size(); ++k) {
+        const Vec3& p = polygon[k].point;
+        ring.push_back(p);
+        for (const Vec3& point : splitSegment(p, polygon[(k + 1) % polygon.size()].point)) ring.push_back(point);
+    }
+    Vec3 middle(0.0, 0.0, 0.0);
+    for (Vec3& point : ring) {
+        point = point * (r / point.length());
+        middle += point;
+    }
+    middle = middle * (r / middle.length());
+    ring.push_back(ring.front());
+
+    double widest = 0;
+    for (const Vec3& point : ring) widest = std::max(widest, std::atan2(middle.cross(point).length(), middle.dot(point)));
+    size_t rows = std::max<size_t>(1, (size_t)std::ceil(widest / ARC_STEP));
 
+    std::vector<Vec3> outer = ring;
+    for (size_t row = rows; row-- > 0;) {
+        std::vector<Vec3> inner;
+        for (const Vec3& point : ring) {
+            Vec3 p = middle + (point - middle) * ((double)row / rows);
+            inner.push_back(row == 0 ? middle : p * (r / p.length()));
+        }
+        for (size_t k = 0; k + 1 < ring.size(); ++k) {
+            // the polygon winds the same way as the die faces, so this faces away from the centre
+            storeCapTriangle(inner[k], outer[k], outer[k + 1]);
+            storeCapTriangle(inner[k], outer[k + 1], inner[k + 1]);
+        }
+        outer.swap(inner);
+    }
+}
+
+// One face: its plane, the disk the sphere cuts from it and its own frame.
+struct FaceFrame {
+    Vec3 center, normal, u, v;
+    double d, rho;
+
+    double angleOf(const Vec3& p) const {
+        Vec3 q = p - center;
+        return std::atan2(q.dot(v), q.dot(u));
+    }
+    Vec3 inPlane(double angle, double distance) const {
+        return center + (u * std::cos(angle) + v * std::sin(angle)) * distance;
+    }
+};
+
+// Distance from the face centre to the polygon edge in a direction; the centre is inside the polygon.
+double polygonReach(const FaceFrame& frame, const std::vector<Corner>& polygon, double angle) {
+    double wu = std::cos(angle), wv = std::sin(angle);
+    double best = std::numeric_limits<double>::max();
+    for (size_t k = 0; k < polygon.size(); ++k) {
+        Vec3 a = polygon[k].point - frame.center, b = polygon[(k + 1) % polygon.size()].point - frame.center;
+        double au = a.dot(frame.u), av = a.dot(frame.v);
+        double eu = b.dot(frame.u) - au, ev = b.dot(frame.v) - av;
+        double length = std::sqrt(eu * eu + ev * ev);
+        if (length == 0) continue;
+        double mu = ev / length, mv = -eu / length;         // outward normal of a CCW edge
+        double facing = mu * wu + mv * wv;
+        if (facing > 0) best = std::min(best, (mu * au + mv * av) / facing);
+    }
+    return best;
+}
+
+// Mesh the part of the sphere over a face that sticks out past its plane's disk: the
+// strip between the arc (on the sphere) and the polygon boundary beyond it, projected
+// onto the sphere.  Both rows start at angle 0 and end at `span`.
+void meshCap(const FaceFrame& frame, const std::vector<Corner>& polygon, double r,
+             double startAngle, double span, const std::vector<RowPoint>& arc, std::vector<RowPoint> edge,
+             bool closed) {
+    double rimTilt = std::atan2(frame.rho, frame.d);
+    double deepest = rimTilt;
+    for (size_t k = 0; k < edge.size(); ++k) {
+        Vec3& point = edge[k].point;
+        deepest = std::max(deepest, std::atan2((point - frame.center).length(), frame.d));
+        // the ends of an open strip are already on the sphere and shared with the flat loop
+        if (closed || (k > 0 && k + 1 < edge.size())) point = point * (r / point.length());
+    }
+    size_t rows = std::max<size_t>(1, (size_t)std::ceil((deepest - rimTilt) / ARC_STEP));
+
+    std::vector<RowPoint> previous = arc;
+    for (size_t row = 1; row < rows; ++row) {
+        double f = (double)row / rows;
+        double tilt = rimTilt + f * (deepest - rimTilt);
+        size_t pieces = std::max<size_t>(1, (size_t)std::ceil(span * std::sin(tilt) / ARC_STEP));
+        std::vector<RowPoint> current;
+        for (size_t k = 0; k <= pieces; ++k) {
+            if (!closed && k == 0) { current.push_back(arc.front()); continue; }
+            if (!closed && k == pieces) { current.push_back(arc.back()); continue; }
+            if (closed && k == pieces) { current.push_back({span, current.front().point}); continue; }
+            double angle = span * k / pieces;
+            double outer = std::atan2(polygonReach(frame, polygon, startAngle + angle), frame.d);
+            Vec3 p = frame.inPlane(startAngle + angle, frame.d * std::tan(rimTilt + f * (outer - rimTilt)));
+            current.push_back({angle, p * (r / p.length())});
+        }
+        stitchRows(previous, current);
+        previous.swap(current);
+    }
+    stitchRows(previous, edge);
+}
+
+// Angle of p around the face counted from start, kept inside [0, span].
+double angleFrom(const FaceFrame& frame, const Vec3& p, double start, double span) {
+    double angle = std::remainder(frame.angleOf(p) - start, 2 * M_PI);
+    if (angle < 0) angle += 2 * M_PI;
+    if (angle > span) angle = angle - span < 2 * M_PI - angle ? span : 0;
+    return angle;
+}
+
+// Boundary loop of one face and the sphere caps beyond it.
+FaceData buildFace(const FaceFrame& frame, const std::vector<Corner>& polygon, double r) {
+    // Walk the polygon, splitting edges where they pass through the sphere and
+    // along the parts outside it (those are shared with the neighbouring cap).
+    std::vector<BoundaryPoint> walk;
+    bool anyCrossing = false;
+    for (size_t k = 0; k < polygon.size(); ++k) {
+        Vec3 p = polygon[k].point, q = polygon[(k + 1) % polygon.size()].point;
+        bool outside = p.lengthSquared() > r * r;
+        walk.push_back({p, outside, false});
+        Vec3 last = p;
+        for (const Vec3& crossing : sphereCrossings(p, q, r)) {
+            if (outside)
+                for (const Vec3& point : splitSegment(last, crossing)) walk.push_back({point, true, false});
+            outside = !outside;
+            walk.push_back({crossing, outside, true});      // marked outside where it leaves the sphere
+            anyCrossing = true;
+            last = crossing;
+        }
+        if (outside)
+            for (const Vec3& point : splitSegment(last, q)) walk.push_back({point, true, false});
+    }
+
+    FaceData face;
+    face.center = frame.center;
+    face.normal = frame.normal;
+    face.u = frame.u;
+    face.v = frame.v;
+
+    if (!anyCrossing) {
+        if (!walk.front().outside) {
+            for (const auto& point : walk) face.loop.push_back(point.point);
+            return face;
+        }
+        // the whole disk fits inside the polygon: round face with a ring of sphere around it
+        double start = frame.angleOf(walk.front().point);
+        size_t pieces = std::max<size_t>(8, (size_t)std::ceil(2 * M_PI * frame.rho / r / ARC_STEP));
+        std::vector<RowPoint> arc, edge;
+        for (size_t k = 0; k < pieces; ++k) {
+            double angle = 2 * M_PI * k / pieces;
+            arc.push_back({angle, frame.inPlane(start + angle, frame.rho)});
+            face.loop.push_back(arc.back().point);
+        }
+        arc.push_back({2 * M_PI, arc.front().point});
+        for (const auto& point : walk) edge.push_back({angleFrom(frame, point.point, start, 2 * M_PI), point.point});
+        edge.front().angle = 0;
+        edge.push_back({2 * M_PI, walk.front().point});
+        meshCap(frame, polygon, r, start, 2 * M_PI, arc, edge, true);
+        return face;
+    }
+
+    // start the walk where it leaves the sphere
+    size_t first = 0;
+    while (!(walk[first].crossing && walk[first].outside)) ++first;
+    std::rotate(walk.begin(), walk.begin() + first, walk.end());
+
+    // a sphere touching an edge gives the same point as entry and exit
+    auto addToLoop = [&face](const Vec3& point) {
+        if (face.loop.empty() || !(face.loop.back() == point)) face.loop.push_back(point);
+    };
+    Vec3 exit;
+    double start = 0;
+    std::vector<Vec3> edge;
+    for (const auto& point : walk) {
+        if (point.crossing && point.outside) {
+            addToLoop(point.point);
+            exit = point.point;
+            start = frame.angleOf(exit);
+            edge.assign(1, exit);
+        } else if (point.crossing) {
+            double span = std::remainder(frame.angleOf(point.point) - start, 2 * M_PI);
+            if (span < 0) span += 2 * M_PI;
+            if (span == 0 && edge.size() > 1) span = 2 * M_PI;     // touches the sphere at one point only
+            size_t pieces = std::max<size_t>(1, (size_t)std::ceil(span * frame.rho / r / ARC_STEP));
+            std::vector<RowPoint> arc(1, {0, exit}), rim(1, {0, exit});
+            for (size_t k = 1; k < pieces; ++k) {
+                double angle = span * k / pieces;
+                arc.push_back({angle, frame.inPlane(start + angle, frame.rho)});
+                addToLoop(arc.back().point);
+            }
+            arc.push_back({span, point.point});
+            for (size_t k = 1; k < edge.size(); ++k)
+                rim.push_back({angleFrom(frame, edge[k], start, span), edge[k]});
+            rim.push_back({span, point.point});
+            meshCap(frame, polygon, r, start, span, arc, rim, false);
+            addToLoop(point.point);
+        } else if (point.outside) {
+            edge.push_back(point.point);
+        } else {
+            addToLoop(point.point);
+        }
+    }
+    if (face.loop.size() > 1 && face.loop.front() == face.loop.back()) face.loop.pop_back();
+    return face;
+}
+
+}
+
+void buildDieSphere(double r, const std::vector<Vec3>& points,
+                    std::vector<FaceData>& faces)
+{
     // Cutting planes (one per die face point)
-    struct CuttingPlane { Plane _plane; Vec3 _point; };
-    std::vector<CuttingPlane> cuttingPlanes;
+    std::vector<Plane> planes;
+    planes.reserve(points.size());
+    double minD = std::numeric_limits<double>::max();
     for (const Vec3& pt : points) {
         Vec3 n = pt; n.normalize();
-        cuttingPlanes.push_back({Plane(n, n.dot(pt)), pt});
+        planes.emplace_back(n, n.dot(pt));
+        minD = std::min(minD, planes.back()._d);
     }
 
-    std::vector<std::vector<Vec3>> planeBoundaries(cuttingPlanes.size());
-
-    // Clip every sphere triangle against all cutting planes
-    for (const auto& fi : sphereFaces) {
-        std::vector<Vec3> clipped = {vertices[fi[0]], vertices[fi[1]], vertices[fi[2]]};
-        for (size_t p = 0; p < cuttingPlanes.size(); ++p) {
-            std::vector<Vec3> tmp, ints;
-            clipPolygonWithPlane(clipped, cuttingPlanes[p]._plane, tmp, ints);
-            planeBoundaries[p].insert(planeBoundaries[p].end(), ints.begin(), ints.end());
-            clipped = tmp;
-            if (clipped.empty()) break;
-        }
-        if (clipped.size() < 3) continue;
-        for (size_t i = 1; i+1 < clipped.size(); ++i) {
-            Vec3 e1 = clipped[i] - clipped[0], e2 = clipped[i+1] - clipped[0];
-            Vec3 fn = e1.cross(e2); fn.normalize();
-            storeTriangle(fn, clipped[0], clipped[i], clipped[i+1]);
+    // Bounding cube, after the die's own planes so face indexes are unchanged
+    size_t faceCount = planes.size();
+    for (int axis = 0; axis < 3; ++axis) {
+        for (double sign : {1.0, -1.0}) {
+            Vec3 n(axis == 0 ? sign : 0.0, axis == 1 ? sign : 0.0, axis == 2 ? sign : 0.0);
+            planes.emplace_back(n, BOUND_SIZE * r);
         }
     }
 
-    // Build face boundary loops (deduplicated, sorted by angle)
+    // Exact polygon of every face, with shared vertices made bit-identical
+    std::vector<std::vector<Corner>> polygons(planes.size());
+    for (size_t p = 0; p < planes.size(); ++p)
+        if (planes[p]._d < r || p >= faceCount) polygons[p] = facePolygon(p, planes, r, minD);
+    weldPolygons(polygons, WELD_TOLERANCE * r);
+    for (size_t p = faceCount; p < planes.size(); ++p)
+        if (!polygons[p].empty()) meshBoundCap(polygons[p], r);
+
     faces.clear();
-    faces.reserve(cuttingPlanes.size());
-    for (size_t p = 0; p < cuttingPlanes.size(); ++p) {
-        auto& ips = planeBoundaries[p];
-        if (ips.empty()) continue;
-
-        std::vector<Vec3> bpts;
-        std::unordered_set<Vec3, Vec3Hash, Vec3Equal> seen;
-        for (const auto& pt : ips)
-            if (seen.find(pt) == seen.end()) { bpts.push_back(pt); seen.insert(pt); }
-
-        Vec3 normal = cuttingPlanes[p]._plane._normal;
-        Vec3 center = cuttingPlanes[p]._point;
-
-        Vec3 u;
-        if (fabs(normal.x) > 1e-6 || fabs(normal.y) > 1e-6)
-            u = Vec3(-normal.y, normal.x, 0.0);
+    faces.reserve(faceCount);
+    for (size_t p = 0; p < faceCount; ++p) {
+        if (polygons[p].empty()) continue;
+        FaceFrame frame;
+        frame.normal = planes[p]._normal;
+        frame.center = points[p];
+        frame.d = planes[p]._d;
+        frame.rho = std::sqrt(r * r - frame.d * frame.d);
+        if (std::fabs(frame.normal.x) > 1e-6 || std::fabs(frame.normal.y) > 1e-6)
+            frame.u = Vec3(-frame.normal.y, frame.normal.x, 0.0);
         else
-            u = Vec3(1.0, 0.0, 0.0);
-        u.normalize();
-        Vec3 v = normal.cross(u);
-
-        std::vector<std::pair<double, Vec3>> av;
-        av.reserve(bpts.size());
-        for (const auto& pt : bpts) {
-            Vec3 d = pt - center;
-            av.emplace_back(atan2(d.dot(v), d.dot(u)), pt);
-        }
-        std::sort(av.begin(), av.end());
-        std::vector<Vec3> loop;
-        loop.reserve(av.size());
-        for (const auto& a : av) loop.push_back(a.second);
-
-        faces.push_back({loop, center, normal, u, v});
+            frame.u = Vec3(1.0, 0.0, 0.0);
+        frame.u.normalize();
+        frame.v = frame.normal.cross(frame.u);
+        faces.push_back(buildFace(frame, polygons[p], r));
     }
 }
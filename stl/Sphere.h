@@ -2,13 +2,15 @@
 #include <vector>
 #include "../Vec3.h"
 
-// One flat face produced by clipping the sphere.
+// One flat face of the die: its plane cut down by the neighbouring planes and the sphere.
 struct FaceData {
     std::vector<Vec3> loop;   // CCW boundary points on the cutting plane
     Vec3 center, normal, u, v;
 };
 
 // Build a sphere of radius r clipped to all die-face cutting planes.
-// Emits sphere triangles via storeTriangle and returns the face boundary loops.
+// Face polygons come straight from the planes; the sphere left over each face
+// is meshed inside that face's own region and emitted via storeTriangle.
+// Returns the face boundary loops, which share their edge points exactly.
 void buildDieSphere(double r, const std::vector<Vec3>& points,
                     std::vector<FaceData>& faces);
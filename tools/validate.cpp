@@ -0,0 +1,248 @@
+// Checks every result in best/ (and best.pack if there is one): the points must be unit length, one per mirror
+// pair, and the stored stress must match the energy recomputed from the points.  Exits with 1 if anything is
+// wrong so it can gate commits of shared results.
+//
+// With -packtest it instead packs best/ into best.pack, as -pack does, and checks that loading each side count
+// then reads it from the archive.  Run it from the directory holding best/.
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "BestArchive.h"
+#include "Checkpoint.h"
+#include "PointSphere.h"
+#include "ThreadPool.h"
+
+using namespace std;
+
+// Largest allowed difference of |p|^2 from 1
+#define UNIT_TOLERANCE 1e-9
+
+namespace {
+    double stressTolerance = 1e-9;      //relative, csv points only keep 15 decimals
+
+    struct Source {
+        string name;
+        size_t sideCount;
+        vector<Vec3> points;
+        double stress;
+        string error;               //set if the file could not be read at all
+    };
+
+    /**
+     * Side count a best file is named after
+     * @param path
+     * @return 0 if the name is not a number
+     */
+    size_t sideCountOf(const filesystem::path& path) {
+        string stem = path.stem().string();
+        if (stem.empty() || !all_of(stem.begin(), stem.end(), ::isdigit)) return 0;
+        return stoul(stem);
+    }
+
+    /**
+     * Read a csv best file without checking anything
+     * @param source name and sideCount already set
+     */
+    void readCsv(Source& source) {
+        ifstream in(source.name);
+        string line, label;
+        if (!getline(in, line)) {
+            source.error = "empty file";
+            return;
+        }
+        stringstream header(line);
+        if (!(header >> label >> source.stress) || label != "Stress:") {
+            source.error = "no Stress: line";
+            return;
+        }
+        getline(in, line);     //rate
+        getline(in, line);     //blank
+        while (getline(in, line)) {
+            if (line.empty()) continue;
+            stringstream ss(line);
+            Vec3 point;
+            char comma;
+            if (!(ss >> point.x >> comma >> point.y >> comma >> point.z)) {
+                source.error = "unreadable point: " + line;
+                return;
+            }
+            source.points.push_back(point);
+        }
+    }
+
+    /**
+     * Read a binary checkpoint, which must pass its own checksum
+     * @param source name and sideCount already set
+     */
+    void readCheckpoint(Source& source) {
+        Checkpoint checkpoint(source.name);
+        if (!checkpoint.isValid()) {
+            source.error = "bad header, size or checksum";
+            return;
+        }
+        if (checkpoint.header().sideCount != source.sideCount) {
+            source.error = "holds " + to_string(checkpoint.header().sideCount) + " sides";
+            return;
+        }
+        source.stress = checkpoint.header().stress;
+        for (size_t i = 0; i < source.sideCount / 2; ++i) source.points.push_back(checkpoint.point(i));
+    }
+
+    /**
+     * Everything wrong with a result
+     * @param source
+     * @return empty if it is fine
+     */
+    string check(Source& source) {
+        if (source.sideCount == 0 || source.sideCount % 2 == 1) return "file name is not an even side count";
+        if (source.name.size() > 4 && source.name.compare(source.name.size() - 4, 4, ".csv") == 0) {
+            readCsv(source);
+        } else if (source.points.empty() && source.error.empty()) {
+            readCheckpoint(source);
+        }
+        if (!source.error.empty()) return source.error;
+
+        ostringstream problems;
+        if (source.points.size() != source.sideCount / 2) {
+            problems << source.points.size() << " points, expected " << source.sideCount / 2 << "; ";
+        }
+        double worst = 0;
+        for (const auto& point: source.points) {
+            if (!isfinite(point.x) || !isfinite(point.y) || !isfinite(point.z)) {
+                problems << "point is not finite; ";
+                worst = 0;
+                break;
+            }
+            worst = max(worst, fabs(point.x * point.x + point.y * point.y + point.z * point.z - 1));
+        }
+        if (worst > UNIT_TOLERANCE) problems << "point off the unit sphere by " << worst << "; ";
+        if (!problems.str().empty()) return problems.str().substr(0, problems.str().size() - 2);
+
+        double actual = PointSphere(source.sideCount, source.points).getTotalStress();
+        double difference = fabs(actual - source.stress) / actual;
+        if (!(difference <= stressTolerance)) {
+            problems << setprecision(15) << "stored stress " << source.stress << ", points give " << actual;
+        }
+        return problems.str();
+    }
+
+    /**
+     * Pack a directory of results into ARCHIVE_FILE and check every side count loads from the archive rather
+     * than falling back to its csv
+     * @param directory
+     * @return process exit code
+     */
+    int packAndLoad(const string& directory) {
+        size_t packed = BestArchive::build(directory);
+        BestArchive archive;
+        if (packed == 0 || !archive.isValid()) {
+            cout << "Could not pack " << directory << "\n";
+            return 1;
+        }
+
+        size_t failed = 0;
+        for (size_t i = 0; i < archive.size(); ++i) {
+            const BestArchive::Entry& entry = archive.entry(i);
+            PointSphere sphere(entry.sideCount);
+            string problem;
+            try {
+                sphere.load();
+                if (sphere.loadedFrom() != ARCHIVE_FILE) problem = "loaded from " + sphere.loadedFrom();
+                for (size_t p = 0; p < entry.sideCount / 2 && problem.empty(); ++p) {
+                    Vec3 stored = archive.point(entry, p);
+                    Vec3 loaded = sphere.getPoint(p * 2);
+                    if (stored.x != loaded.x || stored.y != loaded.y || stored.z != loaded.z) {
+                        problem = "points differ from the archive";
+                    }
+                }
+            } catch (...) {
+                problem = "does not load";
+            }
+            if (problem.empty()) continue;
+            cout << ARCHIVE_FILE << ":" << entry.sideCount << ": " << problem << "\n";
+            ++failed;
+        }
+        cout << archive.size() - failed << "/" << archive.size() << " side counts load from " << ARCHIVE_FILE << "\n";
+        return failed == 0 ? 0 : 1;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    string directory = "best";
+    string archiveFile = ARCHIVE_FILE;
+    bool packTest = false;
+    bool directoryGiven = false;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if      (arg.find("-tol=") == 0)  stressTolerance = stod(arg.substr(5));
+        else if (arg == "-packtest")      packTest = true;
+        else if (arg.find("-pack=") == 0) archiveFile = arg.substr(6);
+        else {
+            directory = arg;
+            directoryGiven = true;
+        }
+    }
+
+    //a directory asked for by name must be there, or a typo would pass with only the archive checked
+    if (directoryGiven && !filesystem::is_directory(directory)) {
+        cout << "not a directory: " << directory << "\n";
+        return 1;
+    }
+
+    if (packTest) return packAndLoad(directory);
+
+    vector<Source> sources;
+    if (filesystem::is_directory(directory)) {
+        for (const auto& file: filesystem::directory_iterator(directory)) {
+            string extension = file.path().extension().string();
+            if (extension != ".csv" && extension != CHECKPOINT_EXTENSION) continue;
+            sources.push_back({file.path().string(), sideCountOf(file.path()), {}, 0, ""});
+        }
+    }
+    BestArchive archive(archiveFile);
+    if (filesystem::exists(archiveFile) && !archive.isValid()) {
+        cout << archiveFile << ": bad header or index checksum\n";
+        return 1;
+    }
+    for (size_t i = 0; i < archive.size(); ++i) {
+        const BestArchive::Entry& entry = archive.entry(i);
+        Source source{archiveFile + ":" + to_string(entry.sideCount), entry.sideCount, {}, entry.stress, ""};
+        if (!archive.verify(entry)) {
+            source.error = "bad checksum";
+        } else {
+            for (size_t p = 0; p < entry.sideCount / 2; ++p) source.points.push_back(archive.point(entry, p));
+        }
+        sources.push_back(std::move(source));
+    }
+    if (sources.empty()) {
+        cout << "Nothing to check in " << directory << "\n";
+        return 1;
+    }
+
+    //biggest first so the long ones do not end up running alone at the end
+    sort(sources.begin(), sources.end(), [](const Source& a, const Source& b) {
+        return a.sideCount != b.sideCount ? a.sideCount > b.sideCount : a.name < b.name;
+    });
+    vector<string> problems(sources.size());
+    ThreadPool::instance().parallelFor(sources.size(), [&](size_t index) {
+        problems[index] = check(sources[index]);
+        vector<Vec3>().swap(sources[index].points);
+    });
+
+    size_t failed = 0;
+    for (size_t i = sources.size(); i-- > 0;) {
+        if (problems[i].empty()) continue;
+        cout << sources[i].name << ": " << problems[i] << "\n";
+        ++failed;
+    }
+    cout << sources.size() - failed << "/" << sources.size() << " results ok\n";
+    return failed == 0 ? 0 : 1;
+}